@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include "Operator.hpp"
+#include "Output.hpp"
+#include "VarStorage.hpp"
+
+namespace Basic
+{
+	struct Line;
+
+	enum class OpCode : Byte
+	{
+		PushConstant, // Pushes constants[operand]
+		Load,         // Pushes value of the variable in the slot operand
+		Store,        // Pops value and saves it to the variable in the slot operand
+		LoadElement,  // Pops indices and pushes element of the array in the slot operand
+		StoreElement, // Pops value and indices and saves value to the array in the slot operand
+		Duplicate,
+		Pop,
+		Unary,        // Operand is Operator::Type
+		Binary,       // Operand is Operator::Type
+		BinaryNumeric, // Binary for operands that are known to be numbers
+		BinaryInteger, // Binary for operands that are known to be integers, e.g. A% + 1
+		Call,         // Operand is Token::Type of the function
+		Reduce,       // Pops arguments and pushes result of SUM, DOT, etc., operand is Token::Type of the function
+		Print,        // Operand is the slot of the printed variable or -1
+		PrintNewLine,
+		PrintUsing,   // Pops values and prints them with formats[operand], arguments is the number of values
+		Jump,         // Operand is position of the instruction
+		JumpIfFalse,
+		ShortCircuit, // Jumps to operand if the left operand of AND or OR decides the result, arguments is Operator::Type
+		JumpLine,     // Pops line number and jumps to it
+		GoSub,        // Operand is position of the instruction
+		GoSubLine,    // Pops line number and calls it
+		Return,
+		For,          // Pops step, end and start values of the loop for the variable in the slot operand
+		Next,         // Operand is -1 if NEXT has no variable
+		Statement,    // Runs statement with the interpreter, operand is position of the token after it
+		End
+	};
+
+	struct Instruction
+	{
+		OpCode code;
+
+		// Number of indices for LoadElement and StoreElement, number of arguments for Reduce
+		// and PrintUsing, Operator::Type for ShortCircuit
+		Byte arguments = 0;
+
+		int operand = 0;
+	};
+
+	// Token of the programm that produced an instruction
+	struct SourceLocation
+	{
+		Line* line = nullptr;
+		int offset = 0;
+	};
+
+	struct Bytecode
+	{
+		std::vector<Instruction> code;
+		std::vector<SourceLocation> sources;
+
+		std::vector<Object> constants;
+
+		// Formats of PRINT USING that are parsed when the programm is compiled
+		std::vector<UsingFormat> formats;
+
+		// Line number -> position of its first instruction
+		std::map<int, int> lines;
+	};
+}
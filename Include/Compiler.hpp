@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Bytecode.hpp"
+#include "Interpreter.hpp"
+
+namespace Basic
+{
+	class Compiler
+	{
+	public:
+		Compiler(const LiteralPool& pool);
+
+	public:
+		// Compiles all lines of the programm into one bytecode stream
+		// so it can be executed without walking through the tokens
+		Bytecode Compile(std::map<int, Line>& programm);
+
+	private:
+		// Type of the value that is known before the programm is run,
+		// it comes from literals and suffixes of the variables (A%, A#, A$)
+		enum class ValueType
+		{
+			Unknown,
+			Numeric,
+			Integer, // Number that fits into an integer variable
+			String
+		};
+
+		// Node of the expression tree that is built from the postfix notation
+		struct Node
+		{
+			const Token* token = nullptr;
+
+			int arguments = 0;
+
+			// Operands of operators, argument of a function or indices of an array
+			std::vector<int> children;
+
+			ValueType type = ValueType::Unknown;
+		};
+
+	private:
+		// Compiles statements until the end of the line or until ELSE
+		// that belongs to an enclosing IF if nested is true
+		Token::Iter CompileStatements(Token::Iter iter, bool nested);
+
+		Token::Iter CompilePrint(Token::Iter iter);
+		Token::Iter CompilePrintUsing(Token::Iter iter);
+		Token::Iter CompileLet(Token::Iter iter);
+		Token::Iter CompileIf(Token::Iter iter, bool nested);
+		Token::Iter CompileJump(Token::Iter iter, OpCode code, OpCode dynamicCode);
+		Token::Iter CompileFor(Token::Iter iter);
+		Token::Iter CompileNext(Token::Iter iter);
+		Token::Iter CompileAssignment(Token::Iter iter);
+
+		// Emits indices of the array between the parentheses, returns iter after them
+		Token::Iter EmitIndices(Token::Iter iter, int& count);
+
+		// Statements that the bytecode doesn't have instructions for are run by the interpreter
+		Token::Iter CompileStatement(Token::Iter iter);
+
+		// Emits instructions of the expression, returns iter if there is no expression at all,
+		// resultSlot gets the slot of the variable if the expression is just a variable
+		Token::Iter EmitExpression(Token::Iter iter, bool discard = false, int* resultSlot = nullptr);
+		void EmitNode(const std::vector<Node>& nodes, int index, bool keep, Token::Iter source);
+
+		ValueType TypeOf(const std::vector<Node>& nodes, const Node& node) const;
+
+		int Emit(OpCode code, int operand, Token::Iter source, Byte arguments = 0);
+		int AddConstant(const Object& value);
+
+	private:
+		Bytecode m_Bytecode;
+
+		const LiteralPool& m_Pool;
+
+		Line* m_Line = nullptr;
+		Token::Iter m_End;
+
+		// Jumps to line numbers that are known only after all lines are compiled
+		std::vector<std::pair<int, int>> m_LineJumps;
+
+	};
+}
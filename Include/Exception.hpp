@@ -10,7 +10,7 @@ namespace Basic
 {
     struct Exception : std::exception
     {
-        Exception(const std::string& line, int pos, const std::string& message);
+        Exception(std::string_view line, int pos, const std::string& message);
 
         const char* what() const noexcept override;
 
@@ -26,9 +26,10 @@ namespace Basic
 		constexpr auto HexDigits = Create("0123456789ABCDEFabcdef");
 		constexpr auto OctDigits = Create("01234567");
 		constexpr auto BinDigits = Create("01");
-        constexpr auto Prefixes = Create("hoHO");
+        constexpr auto Prefixes = Create("hobHOB");
 		constexpr auto Whitespaces = Create(" \t\n\r\v");
-		constexpr auto Symbols = Create("qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM0123456789_.$?");
+		constexpr auto Symbols = Create("qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM0123456789_.?");
+		constexpr auto TypeSuffixes = Create("%!#$");
         constexpr auto Operators = Create("+-*/=<>^");
 		constexpr auto Quotes = Create("'\"");
 	}
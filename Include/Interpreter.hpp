@@ -2,9 +2,14 @@
 
 #include <deque>
 #include <variant>
+#include <optional>
 #include <map>
+#include <cmath>
+#include <limits>
 
+#include "Bytecode.hpp"
 #include "Operator.hpp"
+#include "Output.hpp"
 #include "Parser.hpp"
 #include "Token.hpp"
 #include "VarStorage.hpp"
@@ -22,10 +27,13 @@ namespace Basic
 		return Real(int(0 < v) - int(v < 0));
 	}
 
+	// Values below it are represented exactly by both Real and Integer
+	constexpr Real INTEGRAL_LIMIT = (Real)(1LL << std::numeric_limits<double>::digits);
+
 	bool operator||(const std::string& s1, const std::string& s2);
 	bool operator&&(const std::string& s1, const std::string& s2);
 
-    Exception GenerateException(const std::vector<Basic::Token>& tokens, const std::string& input, const Basic::Exception_Iter& exception);
+    Exception GenerateException(const LiteralPool& pool, const std::vector<Basic::Token>& tokens, const std::string& input, const Basic::Exception_Iter& exception);
 
 	enum Result
 	{
@@ -34,24 +42,100 @@ namespace Basic
 		Result_NextLine = -1
 	};
 
+	// Counter of the FOR loop, loops with integral values are counted
+	// with an integer so they don't accumulate rounding errors
+	struct LoopCounter
+	{
+		LoopCounter() = default;
+		LoopCounter(Real start, Real end, Real step);
+
+		// Steps the loop variable and returns true if the loop continues
+		bool Step(Real& variable);
+
+		Real endValue = 0;
+		Real step = 0;
+
+		bool integral = false;
+
+		Integer count = 0;
+		Integer intEnd = 0;
+		Integer intStep = 0;
+	};
+
 	struct ForNode
 	{
-		std::string varName;
+		int slot;
 
+		// Index of the line in the programm image
 		int line;
 		int posInLine;
 
-		Real startValue;
-		Real endValue;
-		Real step;
+		LoopCounter counter;
 	};
 
 	struct SubNode
 	{
+		// Index of the line in the programm image
 		int line = Result_Undefined;
 		int posInLine = Result_Undefined;
 	};
 
+	// Expression converted to the postfix notation, so it can be evaluated
+	// many times without running the Shunting yard algorithm again
+	struct Expression
+	{
+		std::vector<Token> postfix;
+
+		// Number of tokens from the line that belong to the expression
+		int length = 0;
+	};
+
+	// Converts expression starting from iter to the postfix notation
+	Expression CompileExpression(Token::Iter iter, Token::Iter end);
+
+	// Slot of the variable if the expression is just a variable or an element of an array, -1 otherwise
+	int Expression_ResultSlot(const Expression& expression);
+
+	// Compiled expressions of a single line indexed by the position
+	// of the first token of an expression
+	struct ExpressionCache
+	{
+		std::vector<std::optional<Expression>> entries;
+
+		// Position of the ELSE block (or the end of the line) for
+		// every IF by its position, -1 if it wasn't found yet
+		std::vector<int> elseTargets;
+
+		// Formats of PRINT USING by the position of the format string
+		std::vector<std::optional<UsingFormat>> formats;
+
+		void Reset(size_t tokensCount);
+	};
+
+	struct Line
+	{
+		Line() = default;
+		Line(std::vector<Token>&& tokens);
+
+		std::vector<Token> tokens;
+		ExpressionCache cache;
+
+		// Position of the line number after GOTO or GOSUB -> index
+		// of the target line, filled when the programm image is built
+		std::vector<std::pair<int, int>> jumps;
+	};
+
+	// Lines of the programm laid out contiguously for RUN,
+	// so jumps use indices and the map is only used for editing
+	struct ProgrammImage
+	{
+		std::vector<Line*> lines;
+		std::vector<int> numbers;
+
+		// Returns index of the line or count of the lines if there is no such line
+		int Find(int number) const;
+	};
+
 	class Interpreter
 	{
 	public:
@@ -59,24 +143,95 @@ namespace Basic
 
 	public:
         // Executes line and returns true if it was programm mode (i.e. with line number)
-        bool RunLine(const std::vector<Token>& tokens, int lineNumber = -1);
+        bool RunLine(std::vector<Token>& tokens, int lineNumber = -1);
 
 		// Resets internal state so it is ready to run new line
 		void Reset();
 
+		// Replaces the programm with the one saved by SAVE "<path>",B,
+		// returns false and leaves no programm if the data is damaged
+		bool LoadTokenised(std::string_view data);
+
 		// Checks if cursor is at end of current line
 		inline bool IsEnd() const
 		{
 			return m_Cursor == m_End;
 		}
 
+		// Parser must put text of the tokens here
+		inline LiteralPool& GetPool()
+		{
+			return m_Pool;
+		}
+
+		// Everything that is printed goes through it
+		inline Output& GetOutput()
+		{
+			return m_Output;
+		}
+
+		inline VarStorage& GetVariables()
+		{
+			return m_Variables;
+		}
+
 	private:
+		bool RunLine(const std::vector<Token>& tokens, int lineNumber, ExpressionCache& cache);
+
+		// Gives every symbol of the line a slot in the variable storage
+		void ResolveSymbols(std::vector<Token>& tokens);
+
 		// Parses expression using tokens starting from iter and
 		// returns last object and iterator to token after last-parsed one
         std::pair<Object, Token::Iter> ParseExpression(Token::Iter iter);
 
-		// Parses array index and returns the index value
-		int ParseArrayIndex(Token::Iter& iter);
+		// Evaluates the compiled expression, iter is used for error reporting
+		Object EvaluateExpression(const Expression& expression, Token::Iter iter);
+
+		// Both execution engines use these to work with values
+		Object LoadElement(int slot, const Object* indices, int count, Token::Iter iter);
+		void StoreElement(int slot, const Object* indices, int count, const Object& value, Token::Iter iter);
+
+		// Returns position of the element in the row-major order, all indices are checked at once
+		size_t ElementOffset(const Array& arr, const Object* indices, int count, Token::Iter iter);
+
+		// Saves the value to the variable converting it to the type of the variable
+		void Assign(int slot, const Object& value, Token::Iter iter);
+		Object ConvertValue(VarType type, const Object& value, Token::Iter iter);
+		Real ConvertNumber(VarType type, Real value, Token::Iter iter);
+
+		Object ApplyUnary(Operator::Type type, const Object& operand, Token::Iter iter);
+		Object ApplyBinary(Operator::Type type, const Object& lhs, const Object& rhs, Token::Iter iter);
+		Object ApplyFunction(Token::Type type, const Object& argument, Token::Iter iter);
+
+		// Runs SUM, DOT, MINA, MAXA or MEAN over the elements of the arrays
+		Object ApplyReduction(Token::Type type, const Object* arguments, int count, Token::Iter iter);
+
+		// Values of Single variables (slot) are printed with the precision of float
+		void PrintValue(const Object& value, Token::Iter iter, int slot = -1);
+
+		// Both execution engines use it to write values of PRINT USING
+		void PrintUsing(const UsingFormat& format, const Object* values, int count, Token::Iter iter);
+
+		// Lays out lines of m_Programm and resolves jumps to constant line numbers
+		void BuildImage();
+
+		// Returns index of the line that GOTO or GOSUB jumps to
+		int ParseJumpTarget();
+
+		// Runs the programm compiled with RUN FAST
+		void Execute(const Bytecode& bytecode);
+
+		// Parses indices of the array between the parentheses to m_Indices
+		void ParseArrayIndices(Token::Iter& iter);
+
+		// Creates the array with all elements set to 0
+		Array NewArray(std::vector<int> sizes, Token::Iter iter);
+
+		// Parses sizes of the dimensions between the parentheses and creates the array
+		Array ParseNewArray(Token::Iter& iter);
+
+		const Array& GetArray(int slot, Token::Iter iter);
 
 	private:
 		template <class T>
@@ -84,16 +239,16 @@ namespace Basic
 		{
 			if (std::holds_alternative<Symbol>(obj))
 			{
-				const std::string& name = std::get<Symbol>(obj).value;
+				int slot = std::get<Symbol>(obj).value;
 
 				// Let's check if a variable with the given name exists
-				const auto variable = m_Variables.Get(name);
+				const auto variable = m_Variables.Get(slot);
 
 				if (variable)
 				{
 					// The variable exists...
 
-					const auto value = variable.value().get();
+					const auto& value = variable.value().get();
 
 					if (!std::holds_alternative<T>(value))
 					{
@@ -106,7 +261,7 @@ namespace Basic
 				}
 
 				// Couldn't find the variable so assume it was an invalid symbol
-                throw Exception_Iter(iter, "Unexpected symbol: " + name);
+                throw Exception_Iter(iter, "Unexpected symbol: " + m_Variables.GetName(slot));
 			}
 
 			if (!std::holds_alternative<T>(obj))
@@ -115,14 +270,15 @@ namespace Basic
 			return std::get<T>(obj).value;
 		}
 
-        Object UnwrapValue(Token::Iter iter, const Object& obj)
+        // Returns the value of the variable if obj is a symbol, nothing is copied
+        const Object& UnwrapValue(Token::Iter iter, const Object& obj)
         {
             if (std::holds_alternative<Symbol>(obj))
             {
-                const std::string& name = std::get<Symbol>(obj).value;
+                int slot = std::get<Symbol>(obj).value;
 
                 // Let's check if a variable with the given name exists
-                const auto variable = m_Variables.Get(name);
+                const auto variable = m_Variables.Get(slot);
 
                 if (variable)
                 {
@@ -131,13 +287,14 @@ namespace Basic
                 }
 
                 // Couldn't find the variable so assume it was an invalid symbol
-                throw Exception_Iter(iter, "Unexpected symbol: " + name);
+                throw Exception_Iter(iter, "Unexpected symbol: " + m_Variables.GetName(slot));
             }
 
             return obj;
         }
 
 		void HandlePrint();
+		void HandlePrintUsing();
 		void HandleInput();
 		void HandleCls();
 		void HandleLet();
@@ -153,22 +310,55 @@ namespace Basic
         void HandleNew();
         void HandleRun();
         void HandleLoad();
+        void HandleSave();
 		void HandleDim();
+		void HandleDefType(VarType type);
+		void HandleMat();
+		void HandleSort();
+		void HandleOption();
+		void HandleFlush();
 
 	private:
-        std::map<int, std::vector<Basic::Token>> m_Programm;
+        std::map<int, Line> m_Programm;
 		VarStorage m_Variables;
 
+		// Text and numbers of the tokens of all lines
+		LiteralPool m_Pool;
+
+		Output m_Output;
+
+		// Stack of the expression evaluator
+		std::vector<Object> m_Solving;
+
+		// Indices of the array that are parsed by ParseArrayIndices
+		std::vector<Object> m_Indices;
+
+		// Values of PRINT USING
+		std::vector<Object> m_Using;
+
+		// Right operand of AND or OR isn't evaluated if the left one decides the result,
+		// it's off by default like in MSX BASIC and is set by OPTION SHORTCIRCUIT
+		bool m_ShortCircuit = false;
+
+		// Cache for lines that are executed in immediate mode
+		ExpressionCache m_ImmediateCache;
+		ExpressionCache* m_Cache = nullptr;
+
+		ProgrammImage m_Image;
+
+		// Index of the next line in the image or one of the Result values
 		int m_NextLine;
 		int m_LineOffset = 0;
+
+		// Index of the current line in the image, -1 in the immediate mode
+		int m_LineIndex = -1;
 		
+        Token::Iter m_Begin;
         Token::Iter m_Cursor;
 		Token::Iter m_End;
 
 		std::deque<ForNode> m_ForStack;
 
-        bool m_SkipElse = true;
-
 		std::deque<SubNode> m_SubStack;
 
 	};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+#include "VarStorage.hpp"
+
+namespace Basic
+{
+	// Loops over the elements of arrays that are run natively instead of by the interpreter,
+	// they use SSE2 or NEON when Real is double and plain C++ otherwise
+	namespace Kernels
+	{
+		void Add(Real* out, const Real* lhs, const Real* rhs, size_t count);
+		void Subtract(Real* out, const Real* lhs, const Real* rhs, size_t count);
+		void Scale(Real* out, Real factor, const Real* values, size_t count);
+
+		// out is rows x cols, lhs is rows x inner and rhs is inner x cols
+		void Multiply(Real* out, const Real* lhs, const Real* rhs, size_t rows, size_t inner, size_t cols);
+
+		// out is cols x rows, values is rows x cols
+		void Transpose(Real* out, const Real* values, size_t rows, size_t cols);
+
+		Real Sum(const Real* values, size_t count);
+		Real Dot(const Real* lhs, const Real* rhs, size_t count);
+
+		// count must be at least 1, the result is NaN if any of the values is NaN
+		Real Min(const Real* values, size_t count);
+		Real Max(const Real* values, size_t count);
+
+		// Big arrays are split between threads, parts are sorted at once and then merged, NaNs go to the end
+		void Sort(Real* values, size_t count, bool descending);
+	}
+}
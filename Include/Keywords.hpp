@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <limits>
+
+#include "Operator.hpp"
+#include "Token.hpp"
+
+namespace Basic
+{
+	namespace Keywords
+	{
+		template <class T>
+		struct Entry
+		{
+			// Must be in the upper case
+			std::string_view name;
+			T value;
+		};
+
+		constexpr char ToUpper(char c)
+		{
+			return ('a' <= c && c <= 'z') ? c + ('Z' - 'z') : c;
+		}
+
+		// FNV-1a of the text in the upper case, so letters case doesn't matter
+		constexpr uint32_t Hash(std::string_view text, uint32_t seed)
+		{
+			uint32_t hash = 2166136261u ^ seed;
+
+			for (char c : text)
+			{
+				hash ^= (uint8_t)ToUpper(c);
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+
+		constexpr bool Equals(std::string_view text, std::string_view name)
+		{
+			if (text.size() != name.size())
+				return false;
+
+			for (size_t i = 0; i < text.size(); i++)
+			{
+				if (ToUpper(text[i]) != name[i])
+					return false;
+			}
+
+			return true;
+		}
+
+		// Hash table that is built at compile time: the seed is searched
+		// until every name gets its own bucket, so a lookup is one hash and one compare
+		template <class T, size_t N, size_t Size>
+		class PerfectHash
+		{
+		public:
+			constexpr PerfectHash(const std::array<Entry<T>, N>& entries) : m_Entries(entries)
+			{
+				for (uint32_t seed = 0; seed < 10000; seed++)
+				{
+					if (TryBuild(seed))
+					{
+						m_Seed = seed;
+						return;
+					}
+				}
+
+				throw "Can't build perfect hash, make the table bigger";
+			}
+
+			constexpr const Entry<T>* Find(std::string_view text) const
+			{
+				Byte index = m_Buckets[Hash(text, m_Seed) % Size];
+
+				if (index == EMPTY || !Equals(text, m_Entries[index].name))
+					return nullptr;
+
+				return &m_Entries[index];
+			}
+
+		private:
+			constexpr bool TryBuild(uint32_t seed)
+			{
+				m_Buckets.fill(EMPTY);
+
+				for (size_t i = 0; i < N; i++)
+				{
+					Byte& bucket = m_Buckets[Hash(m_Entries[i].name, seed) % Size];
+
+					if (bucket != EMPTY)
+						return false;
+
+					bucket = (Byte)i;
+				}
+
+				return true;
+			}
+
+		private:
+			static constexpr Byte EMPTY = std::numeric_limits<Byte>::max();
+			static_assert(N < EMPTY);
+
+			std::array<Entry<T>, N> m_Entries;
+			std::array<Byte, Size> m_Buckets{};
+
+			uint32_t m_Seed = 0;
+
+		};
+
+		template <size_t Size, class T, size_t N>
+		constexpr auto MakePerfectHash(const Entry<T>(&entries)[N])
+		{
+			std::array<Entry<T>, N> table{};
+
+			for (size_t i = 0; i < N; i++)
+				table[i] = entries[i];
+
+			return PerfectHash<T, N, Size>(table);
+		}
+
+		constexpr auto KeywordTable = MakePerfectHash<512, Token::Type>({
+			{ "PRINT", Token::Type::Keyword_Print },
+			{ "INPUT", Token::Type::Keyword_Input },
+			{ "CLS", Token::Type::Keyword_Cls },
+			{ "LET", Token::Type::Keyword_Let },
+			{ "REM", Token::Type::Keyword_Rem },
+			{ "GOTO", Token::Type::Keyword_Goto },
+			{ "IF", Token::Type::Keyword_If },
+			{ "THEN", Token::Type::Keyword_Then },
+			{ "ELSE", Token::Type::Keyword_Else },
+			{ "FOR", Token::Type::Keyword_For },
+			{ "TO", Token::Type::Keyword_To },
+			{ "STEP", Token::Type::Keyword_Step },
+			{ "NEXT", Token::Type::Keyword_Next },
+			{ "SLEEP", Token::Type::Keyword_Sleep },
+			{ "SIN", Token::Type::Keyword_Sin },
+			{ "COS", Token::Type::Keyword_Cos },
+			{ "TAN", Token::Type::Keyword_Tan },
+			{ "ARCSIN", Token::Type::Keyword_ArcSin },
+			{ "ARCCOS", Token::Type::Keyword_ArcCos },
+			{ "ARCTAN", Token::Type::Keyword_ArcTan },
+			{ "SQR", Token::Type::Keyword_Sqrt },
+			{ "LN", Token::Type::Keyword_Ln },
+			{ "LOG", Token::Type::Keyword_Log },
+			{ "EXP", Token::Type::Keyword_Exp },
+			{ "ABS", Token::Type::Keyword_Abs },
+			{ "SGN", Token::Type::Keyword_Sign },
+			{ "INT", Token::Type::Keyword_Int },
+			{ "RND", Token::Type::Keyword_Random },
+			{ "END", Token::Type::Keyword_End },
+			{ "GOSUB", Token::Type::Keyword_GoSub },
+			{ "RETURN", Token::Type::Keyword_Return },
+			{ "VAL", Token::Type::Keyword_Val },
+			{ "STR$", Token::Type::Keyword_Str },
+			{ "LIST", Token::Type::Keyword_List },
+			{ "RUN", Token::Type::Keyword_Run },
+			{ "FAST", Token::Type::Keyword_Fast },
+			{ "NEW", Token::Type::Keyword_New },
+			{ "LOAD", Token::Type::Keyword_Load },
+			{ "SAVE", Token::Type::Keyword_Save },
+			{ "DIM", Token::Type::Keyword_Dim },
+			{ "DEFINT", Token::Type::Keyword_DefInt },
+			{ "DEFSNG", Token::Type::Keyword_DefSng },
+			{ "DEFDBL", Token::Type::Keyword_DefDbl },
+			{ "DEFSTR", Token::Type::Keyword_DefStr },
+			{ "MAT", Token::Type::Keyword_Mat },
+			{ "ZER", Token::Type::Keyword_Zer },
+			{ "CON", Token::Type::Keyword_Con },
+			{ "IDN", Token::Type::Keyword_Idn },
+			{ "TRN", Token::Type::Keyword_Trn },
+			{ "SUM", Token::Type::Keyword_Sum },
+			{ "DOT", Token::Type::Keyword_Dot },
+			{ "MINA", Token::Type::Keyword_MinA },
+			{ "MAXA", Token::Type::Keyword_MaxA },
+			{ "MEAN", Token::Type::Keyword_Mean },
+			{ "SORT", Token::Type::Keyword_Sort },
+			{ "DESC", Token::Type::Keyword_Desc },
+			{ "OPTION", Token::Type::Keyword_Option },
+			{ "FLUSH", Token::Type::Keyword_Flush },
+			{ "USING", Token::Type::Keyword_Using },
+			{ "AND", Token::Type::Operator },
+			{ "OR", Token::Type::Operator }
+		});
+
+		constexpr auto OperatorTable = MakePerfectHash<64, Operator>({
+			{ "=", { Operator::Type::Assign, 0, 2 } },
+			{ "AND", { Operator::Type::And, 1, 2 } },
+			{ "OR", { Operator::Type::Or, 2, 2 } },
+			{ "==", { Operator::Type::Equals, 3, 2 } },
+			{ "<>", { Operator::Type::NotEquals, 3, 2 } },
+			{ "<", { Operator::Type::Less, 3, 2 } },
+			{ ">", { Operator::Type::Greater, 3, 2 } },
+			{ "<=", { Operator::Type::LessEquals, 3, 2 } },
+			{ ">=", { Operator::Type::GreaterEquals, 3, 2 } },
+			{ "-", { Operator::Type::Subtraction, 4, 2 } },
+			{ "+", { Operator::Type::Addition, 4, 2 } },
+			{ "*", { Operator::Type::Multiplication, 5, 2 } },
+			{ "/", { Operator::Type::Division, 5, 2 } },
+			{ "^", { Operator::Type::Power, 6, 2 } },
+
+			{ "U-", { Operator::Type::Subtraction, Operator::MAX_PRECEDENCE, 1 } },
+			{ "U+", { Operator::Type::Addition, Operator::MAX_PRECEDENCE, 1 } }
+		});
+	}
+}
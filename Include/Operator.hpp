@@ -8,7 +8,7 @@ namespace Basic
 
 	struct Operator
 	{
-		enum class Type
+		enum class Type : Byte
 		{
 			Subtraction,
 			Addition,
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "VarStorage.hpp"
+
+namespace Basic
+{
+	// Longest text of a number that Real_Format writes
+	constexpr size_t REAL_FORMAT_SIZE = 64;
+
+	// Writes the shortest text that is read back as the same number like MSX BASIC does:
+	// a space in place of the plus sign, integers without the decimal point and the exponent
+	// in the upper case (e.g. " 5", "-0.25", " 1E+20"), returns the end of the text,
+	// single values are read back as float, so 0.1 stored in A! is written as 0.1
+	char* Real_Format(Real value, char* text, bool single = false);
+
+	// Format string of PRINT USING that is parsed once and then used for every value
+	struct UsingFormat
+	{
+		struct Field
+		{
+			enum class Kind : uint8_t
+			{
+				Number,      // ###.##, also with +, -, **, $$, comma and ^^^^
+				FirstChar,   // !
+				FixedString, // \  \, as wide as the backslashes and the spaces between them
+				WholeString  // &
+			};
+
+			Kind kind = Kind::Number;
+
+			// Text before the field is written as is
+			std::string prefix;
+
+			// Positions before the decimal point including $, * and commas
+			int digits = 0;
+
+			// Positions after the decimal point, -1 if there is no point
+			int decimals = -1;
+
+			// Width of the FixedString field
+			int width = 0;
+
+			bool leadingPlus = false;
+			bool trailingPlus = false;
+			bool trailingMinus = false;
+			bool asterisks = false;
+			bool dollar = false;
+			bool comma = false;
+			bool exponent = false;
+		};
+
+		// Fields are used in a cycle if there are more values than fields
+		std::vector<Field> fields;
+
+		// Text after the last field
+		std::string suffix;
+
+		static UsingFormat Parse(std::string_view text);
+	};
+
+	// Text printed by the programm is collected here and written with one call
+	// when the buffer is full or when the text has to be seen (INPUT, FLUSH, end of the programm)
+	class Output
+	{
+	public:
+		// Output is line buffered if the stream is a terminal
+		Output(std::ostream& stream = std::cout, size_t capacity = 64 * 1024);
+		~Output();
+
+	public:
+		void Write(std::string_view text);
+
+		// Numbers are followed by a space like in MSX BASIC
+		void Write(Real value, bool single = false);
+
+		// Numbers that don't fit into the field are written after %
+		void WriteUsing(const UsingFormat::Field& field, Real value);
+		void WriteUsing(const UsingFormat::Field& field, std::string_view text);
+
+		// Also flushes the buffer if the output is line buffered
+		void NewLine();
+
+		void Flush();
+
+		inline void SetLineBuffered(bool lineBuffered)
+		{
+			m_LineBuffered = lineBuffered;
+		}
+
+		inline bool IsLineBuffered() const
+		{
+			return m_LineBuffered;
+		}
+
+	private:
+		std::ostream& m_Stream;
+
+		std::string m_Buffer;
+		size_t m_Capacity;
+
+		bool m_LineBuffered;
+
+	};
+}
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <unordered_map>
 #include <string>
 #include <vector>
 
@@ -16,7 +15,7 @@ namespace Basic
 	class Parser
 	{
 	public:
-		Parser() = default;
+		Parser(LiteralPool& pool);
 
 	public:
 		enum class State
@@ -34,10 +33,11 @@ namespace Basic
 		};
 
 		// Splits input into tokens and returns line number, -1 if no line was specified
-        void Tokenise(const std::string& input, std::vector<Token>& tokens);
+        void Tokenise(std::string_view input, std::vector<Token>& tokens);
 
-	public:
-		static std::unordered_map<std::string, Operator> s_Operators;
+	private:
+		// Text and numbers of the tokens are stored here
+		LiteralPool& m_Pool;
 
 	};
 }
@@ -1,21 +1,36 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+
 #include "Interpreter.hpp"
 #include "Parser.hpp"
 
 namespace Basic
 {
+	// Runs BASIC code without the prompt, errors are printed to std::cerr
 	class State
 	{
 	public:
 		State();
 
-		void DoFile(std::string_view path);
-		void DoString(std::string_view);
+		// Runs lines of the file like LOAD does, then runs the programm if the file
+		// has only numbered lines or was saved with SAVE "<path>",B, returns false if there was an error
+		bool DoFile(std::string_view path);
+
+		// Runs every line as if it was typed in, numbered lines are added to the programm
+		bool DoString(std::string_view source);
+
+		// Arguments of the programm, it gets them in COMMAND$
+		void SetCommand(const std::string& command);
+
+	private:
+		// immediate is set if there was a line without a number
+		bool Execute(std::string_view source, bool& immediate);
 
 	private:
 		Interpreter m_Interpreter;
 		Parser m_Parser;
 
 	};
-}
\ No newline at end of file
+}
@@ -1,7 +1,13 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+#include "VarStorage.hpp"
+#include "Operator.hpp"
 
 namespace Basic
 {
@@ -9,7 +15,7 @@ namespace Basic
 	{
         using Iter = std::vector<Token>::const_iterator;
 
-		enum class Type
+		enum class Type : Byte
 		{
 			None,
 			Literal_NumericBaseUnknown,
@@ -28,6 +34,12 @@ namespace Basic
 			Bracket_Open,
 			Bracket_Close,
 
+			// Array access, produced by the expression compiler only
+			Subscript,
+
+			// Skips the right operand of AND or OR, produced by the expression compiler only
+			ShortCircuit,
+
 			Keyword_Print,
 			Keyword_Input,
 			Keyword_Cls,
@@ -58,25 +70,112 @@ namespace Basic
             Keyword_Random,
             Keyword_End,
             Keyword_Val,
+            Keyword_Str,
             Keyword_GoSub,
             Keyword_Return,
 
 			Keyword_List,
 			Keyword_Run,
+			Keyword_Fast,
             Keyword_New,
             Keyword_Load,
-			Keyword_Dim
+			Keyword_Dim,
+			Keyword_DefInt,
+			Keyword_DefSng,
+			Keyword_DefDbl,
+			Keyword_DefStr,
+			Keyword_Mat,
+			Keyword_Zer,
+			Keyword_Con,
+			Keyword_Idn,
+			Keyword_Trn,
+			Keyword_Sum,
+			Keyword_Dot,
+			Keyword_MinA,
+			Keyword_MaxA,
+			Keyword_Mean,
+			Keyword_Sort,
+			Keyword_Desc,
+			Keyword_Option,
+			Keyword_Flush,
+			Keyword_Using,
+			Keyword_Save
 		};
 
-		Token() = default;
-		Token(Type type, const std::string_view value = "");
-
         bool IsFunction() const;
 
+        // Functions that take a whole array, e.g. SUM(A)
+        bool IsReduction() const;
+        bool IsNumeric() const;
+
 		Type type = Type::None;
-		std::string value;
+
+		// Resolved operator if the token is an operator,
+		// op.arguments is the number of indices if the token is a subscript
+		// and the number of arguments if the token is a reduction
+		Operator op{};
+
+		// Index of the token's text in the LiteralPool
+		int text = -1;
+
+		union
+		{
+			// Slot of the variable if the token is a symbol
+			int slot = -1;
+
+			// Index of the decoded value in the LiteralPool if the token is a numeric or string literal
+			int literal;
+
+			// Position of the AND or OR in the postfix notation if the token is a short circuit
+			int target;
+		};
 
     };
 
-    std::string TokensToString(const std::vector<Token>& tokens);
+	static_assert(std::is_trivially_copyable_v<Token>);
+
+	// Tokens are small and trivially copyable, so their text
+	// and numeric values are stored here and referenced by index
+	class LiteralPool
+	{
+	public:
+		LiteralPool() = default;
+
+	public:
+		// Equal values share the same index, so lines that are typed
+		// again or loaded again don't make the pool bigger
+		int AddText(std::string_view text);
+		int AddNumber(Real value);
+
+		// String literals are their texts, so both indices are the same
+		int AddString(std::string_view text);
+
+		inline const std::string& GetText(const Token& token) const
+		{
+			return *m_Texts[token.text].value;
+		}
+
+		inline Real GetNumber(const Token& token) const
+		{
+			return m_Numbers[token.literal];
+		}
+
+		inline const String& GetString(const Token& token) const
+		{
+			return m_Texts[token.literal];
+		}
+
+	private:
+		// Texts are kept as strings, so string literals share them with the variables
+		std::vector<String> m_Texts;
+
+		// Keys point to the texts that never move
+		std::unordered_map<std::string_view, int> m_TextIndices;
+
+		std::vector<Real> m_Numbers;
+		std::unordered_map<Real, int> m_NumberIndices;
+
+	};
+
+    std::string TokensToString(const std::vector<Token>& tokens, const LiteralPool& pool);
 }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "Interpreter.hpp"
+
+namespace Basic
+{
+	// Programm saved by SAVE "<path>",B: tokens are stored already classified and
+	// literals already decoded, so LOAD doesn't have to run the parser again
+	namespace Tokenised
+	{
+		// Must be changed when Token::Type or Operator::Type are changed
+		constexpr uint16_t VERSION = 1;
+
+		// Checks if the data starts like a tokenised programm
+		bool IsTokenised(std::string_view data);
+
+		std::string Write(const std::map<int, Line>& programm, const LiteralPool& pool);
+
+		// Symbols of the lines don't have slots yet, returns false if the data
+		// is damaged or was saved by another version of the interpreter
+		bool Read(std::string_view data, std::map<int, Line>& programm, LiteralPool& pool);
+	}
+}
@@ -6,10 +6,33 @@
 #include <optional>
 #include <numeric>
 #include <vector>
+#include <memory>
+#include <type_traits>
+#include <string_view>
+#include <array>
+#include <cstdint>
 
 namespace Basic
 {
+	// Numbers are double by default, define BASIC_LONG_DOUBLE
+	// to get the extended precision of the older versions
+#ifdef BASIC_LONG_DOUBLE
 	using Real = long double;
+#else
+	using Real = double;
+#endif
+
+	// Integral values (e.g. loop counters) are computed with it
+	using Integer = long long;
+
+	// Converts text to the number without losing precision of Real
+	inline Real Real_Parse(const std::string& text)
+	{
+		if constexpr (std::is_same_v<Real, double>)
+			return std::stod(text);
+		else
+			return std::stold(text);
+	}
 
 	template <class T>
 	struct Type
@@ -24,26 +47,128 @@ namespace Basic
 		static constexpr Real EPS = std::numeric_limits<Real>::epsilon();
 	};
 
-	struct String : Type<std::string> {};
-	struct Symbol : Type<std::string> {};
+	// Elements of arrays are passed to the kernels as arrays of Real
+	static_assert(sizeof(Numeric) == sizeof(Real));
+
+	// Text is immutable, so copies of a string share it instead of copying it
+	struct String
+	{
+		String() = default;
+		String(std::string text) : value(std::make_shared<const std::string>(std::move(text))) {}
 
-	struct Array : Type<std::vector<Numeric>> {};
+		std::shared_ptr<const std::string> value;
+	};
+
+	// Reference to a variable by its slot in VarStorage
+	struct Symbol : Type<int> {};
+
+	// Copies of an array share its elements until one of the copies is changed
+	struct Array
+	{
+		Array() = default;
+		Array(std::vector<int> sizes, std::vector<Numeric> elements)
+			: value(std::make_shared<std::vector<Numeric>>(std::move(elements))),
+			sizes(std::make_shared<const std::vector<int>>(std::move(sizes))) {}
+
+		// Elements are copied first if another array shares them
+		inline std::vector<Numeric>& Mutable()
+		{
+			if (value.use_count() > 1)
+				value = std::make_shared<std::vector<Numeric>>(*value);
+
+			return *value;
+		}
+
+		inline const Real* Data() const
+		{
+			return &value->data()->value;
+		}
+
+		inline Real* MutableData()
+		{
+			return &Mutable().data()->value;
+		}
+
+		// Elements of all dimensions in the row-major order
+		std::shared_ptr<std::vector<Numeric>> value;
+
+		// Sizes of the dimensions, they don't change after DIM
+		std::shared_ptr<const std::vector<int>> sizes;
+	};
 
 	using Object = std::variant<Numeric, String, Symbol, Array>;
 
+	// Variables without a type can hold any value, typed ones always hold a value of their type
+	enum class VarType : uint8_t
+	{
+		Any,
+		Integer, // A%
+		Single,  // A!
+		Double,  // A#
+		String   // A$
+	};
+
+	// Range of the integer variables as in MSX BASIC
+	constexpr Integer VARINT_MIN = -32768;
+	constexpr Integer VARINT_MAX = 32767;
+
+	// Returns type given by the suffix of the name, Any if there is no suffix
+	VarType VarType_FromName(std::string_view name);
+
 	class VarStorage
 	{
 	public:
 		VarStorage() = default;
 
 	public:
+		// Returns slot of the variable, a new slot is given to every distinct name
+		int Resolve(const std::string& name);
+
+		const std::string& GetName(int slot) const;
+
+		inline VarType GetType(int slot) const
+		{
+			return m_Types[slot];
+		}
+
+		// DEFINT, DEFSNG, DEFDBL and DEFSTR: variables without suffix that
+		// start with a letter from first to last get the type and its default value
+		void SetDefaultType(char first, char last, VarType type);
+
+		inline void Set(int slot, const Object& value)
+		{
+			m_Values[slot] = value;
+		}
+
+		inline std::optional<std::reference_wrapper<Object>> Get(int slot)
+		{
+			auto& value = m_Values[slot];
+
+			if (!value)
+				return std::nullopt;
+
+			return *value;
+		}
+
+		// Lookup by name is only needed outside of the programm execution
 		void Set(const std::string& name, const Object& value);
 
 		std::optional<std::reference_wrapper<Object>> Get(const std::string& name);
 
+		// Removes values of all variables and default types, slots remain valid
 		void Clear();
 
 	private:
-		std::unordered_map<std::string, Object> m_Values;
+		// Type of the variable without suffix depends on the first letter of its name
+		VarType TypeOf(const std::string& name) const;
+
+	private:
+		std::unordered_map<std::string, int> m_Slots;
+		std::vector<std::string> m_Names;
+		std::vector<VarType> m_Types;
+
+		std::array<VarType, 26> m_Defaults{};
+
+		std::vector<std::optional<Object>> m_Values;
 	};
 }
@@ -2,6 +2,6 @@ QT = core
 
 CONFIG += c++20 cmdline
 
-SOURCES += ../Sources/Exception.cpp ../Sources/Interpreter.cpp ../Sources/Parser.cpp ../Sources/Source.cpp ../Sources/Token.cpp ../Sources/VarStorage.cpp
-HEADERS += ../Include/Exception.hpp ../Include/Interpreter.hpp ../Include/Parser.hpp ../Include/Guard.hpp  ../Include/Token.hpp ../Include/VarStorage.hpp ../Include/Operator.hpp
+SOURCES += ../Sources/Exception.cpp ../Sources/Interpreter.cpp ../Sources/Parser.cpp ../Sources/Source.cpp ../Sources/Token.cpp ../Sources/VarStorage.cpp ../Sources/Compiler.cpp ../Sources/Kernels.cpp ../Sources/Output.cpp ../Sources/State.cpp ../Sources/Tokenised.cpp
+HEADERS += ../Include/Exception.hpp ../Include/Interpreter.hpp ../Include/Parser.hpp ../Include/Guard.hpp  ../Include/Token.hpp ../Include/VarStorage.hpp ../Include/Operator.hpp ../Include/Bytecode.hpp ../Include/Compiler.hpp ../Include/Keywords.hpp ../Include/Kernels.hpp ../Include/Output.hpp ../Include/State.hpp ../Include/Tokenised.hpp
 
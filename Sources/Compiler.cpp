@@ -0,0 +1,673 @@
+#include "../Include/Compiler.hpp"
+
+namespace Basic
+{
+	Compiler::Compiler(const LiteralPool& pool) : m_Pool(pool)
+	{
+
+	}
+
+	Bytecode Compiler::Compile(std::map<int, Line>& programm)
+	{
+		for (auto& [number, line] : programm)
+		{
+			m_Line = &line;
+			m_End = line.tokens.cend();
+
+			m_Bytecode.lines[number] = (int)m_Bytecode.code.size();
+
+			try
+			{
+				CompileStatements(line.tokens.cbegin(), false);
+			}
+			catch (const Exception_Iter& e)
+			{
+				throw GenerateException(m_Pool, line.tokens, TokensToString(line.tokens, m_Pool), e);
+			}
+		}
+
+		if (m_Line)
+			Emit(OpCode::End, 0, m_End);
+
+		// Now all lines are known so jumps can be resolved
+		for (const auto& [position, number] : m_LineJumps)
+		{
+			auto line = m_Bytecode.lines.find(number);
+
+			// Jump to the line that doesn't exist stops the programm
+			if (line == m_Bytecode.lines.end())
+				m_Bytecode.code[position] = Instruction{ OpCode::End };
+			else
+				m_Bytecode.code[position].operand = line->second;
+		}
+
+		return std::move(m_Bytecode);
+	}
+
+	Token::Iter Compiler::CompileStatements(Token::Iter iter, bool nested)
+	{
+		bool newStmt = true;
+
+		while (iter != m_End)
+		{
+			if (iter->type == Token::Type::Colon)
+			{
+				newStmt = true;
+				++iter;
+				continue;
+			}
+
+			if (iter->type == Token::Type::Keyword_Else)
+			{
+				// ELSE after the executed THEN block skips the rest of the line
+				return nested ? iter : m_End;
+			}
+
+			if (!newStmt)
+				throw Exception_Iter(iter, "Expected : before new statement");
+
+			newStmt = false;
+
+			switch (iter->type)
+			{
+			case Token::Type::Keyword_Print: iter = CompilePrint(iter); break;
+			case Token::Type::Keyword_Let: iter = CompileLet(iter); break;
+			case Token::Type::Keyword_If: iter = CompileIf(iter, nested); break;
+			case Token::Type::Keyword_Goto: iter = CompileJump(iter, OpCode::Jump, OpCode::JumpLine); break;
+			case Token::Type::Keyword_GoSub: iter = CompileJump(iter, OpCode::GoSub, OpCode::GoSubLine); break;
+			case Token::Type::Keyword_For: iter = CompileFor(iter); break;
+			case Token::Type::Keyword_Next: iter = CompileNext(iter); break;
+			case Token::Type::Keyword_Rem: return m_End;
+			case Token::Type::Keyword_Return: Emit(OpCode::Return, 0, iter++); break;
+			case Token::Type::Keyword_End: Emit(OpCode::End, 0, iter++); break;
+
+			case Token::Type::Keyword_Input:
+			case Token::Type::Keyword_Cls:
+			case Token::Type::Keyword_Sleep:
+			case Token::Type::Keyword_Dim:
+			case Token::Type::Keyword_DefInt:
+			case Token::Type::Keyword_DefSng:
+			case Token::Type::Keyword_DefDbl:
+			case Token::Type::Keyword_DefStr:
+			case Token::Type::Keyword_Mat:
+			case Token::Type::Keyword_Sort:
+			case Token::Type::Keyword_Option:
+			case Token::Type::Keyword_Flush:
+			case Token::Type::Keyword_List:
+			case Token::Type::Keyword_Save:
+			case Token::Type::Keyword_Run:
+			case Token::Type::Keyword_New:
+			case Token::Type::Keyword_Load:
+				iter = CompileStatement(iter);
+			break;
+
+			default: iter = CompileAssignment(iter); break;
+			}
+		}
+
+		return iter;
+	}
+
+	// PRINT <?expr>; <?expr>; ...
+	Token::Iter Compiler::CompilePrint(Token::Iter iter)
+	{
+		auto next = std::next(iter);
+
+		if (next != m_End && next->type == Token::Type::Keyword_Using)
+		{
+			// Format that is computed is parsed by the interpreter every time
+			if (std::next(next) == m_End || std::next(next)->type != Token::Type::Literal_String)
+				return CompileStatement(iter);
+
+			return CompilePrintUsing(std::next(next));
+		}
+
+		do
+		{
+			// PRINT / ;
+			++iter;
+
+			// <?expr>
+			int slot;
+			auto end = EmitExpression(iter, false, &slot);
+
+			if (end != iter)
+			{
+				Emit(OpCode::Print, slot, iter);
+				iter = end;
+			}
+		}
+		while (iter != m_End && iter->type == Token::Type::Semicolon);
+
+		if (std::prev(iter)->type != Token::Type::Semicolon)
+			Emit(OpCode::PrintNewLine, 0, iter);
+
+		return iter;
+	}
+
+	// PRINT USING <format>; <expr>; ...
+	Token::Iter Compiler::CompilePrintUsing(Token::Iter iter)
+	{
+		const auto source = iter;
+
+		m_Bytecode.formats.push_back(UsingFormat::Parse(*m_Pool.GetString(*iter).value));
+
+		// <format>
+		++iter;
+
+		int count = 0;
+
+		// ; <expr>
+		while (iter != m_End && iter->type == Token::Type::Semicolon)
+		{
+			++iter;
+
+			auto end = EmitExpression(iter);
+
+			if (end == iter)
+				break;
+
+			if (++count > std::numeric_limits<Byte>::max())
+				throw Exception_Iter(iter, "Too many values");
+
+			iter = end;
+		}
+
+		Emit(OpCode::PrintUsing, (int)m_Bytecode.formats.size() - 1, source, (Byte)count);
+
+		if (std::prev(iter)->type != Token::Type::Semicolon)
+			Emit(OpCode::PrintNewLine, 0, iter);
+
+		return iter;
+	}
+
+	// LET <name> = <expr>
+	Token::Iter Compiler::CompileLet(Token::Iter iter)
+	{
+		// LET
+		++iter;
+
+		// <name>
+		if (iter == m_End || iter->type != Token::Type::Symbol)
+			throw Exception_Iter(iter, "Expected variable name");
+
+		int slot = iter->slot;
+		++iter;
+
+		// =
+		if (iter == m_End || iter->type != Token::Type::Operator || iter->op.type != Operator::Type::Assign)
+			throw Exception_Iter(iter, "Expected =");
+
+		++iter;
+
+		// <expr>
+		auto end = EmitExpression(iter);
+
+		if (end == iter)
+			throw Exception_Iter(iter, "Expected expression");
+
+		Emit(OpCode::Store, slot, iter);
+
+		return end;
+	}
+
+	// IF <expr> THEN <stmt> ELSE <stmt>
+	Token::Iter Compiler::CompileIf(Token::Iter iter, bool nested)
+	{
+		// IF
+		++iter;
+
+		// <expr>
+		auto condition = iter;
+		iter = EmitExpression(iter);
+
+		if (iter == condition)
+			throw Exception_Iter(condition, "Expected expression result to be numeric");
+
+		// THEN
+		if (iter == m_End || iter->type != Token::Type::Keyword_Then)
+			throw Exception_Iter(iter, "Expected THEN");
+
+		int jumpToElse = Emit(OpCode::JumpIfFalse, 0, condition);
+
+		iter = CompileStatements(iter + 1, true);
+
+		if (iter != m_End && iter->type == Token::Type::Keyword_Else)
+		{
+			int jumpToEnd = Emit(OpCode::Jump, 0, iter);
+
+			m_Bytecode.code[jumpToElse].operand = (int)m_Bytecode.code.size();
+
+			iter = CompileStatements(iter + 1, nested);
+
+			m_Bytecode.code[jumpToEnd].operand = (int)m_Bytecode.code.size();
+		}
+		else
+			m_Bytecode.code[jumpToElse].operand = (int)m_Bytecode.code.size();
+
+		return iter;
+	}
+
+	// GOTO <line>, GOSUB <line>
+	Token::Iter Compiler::CompileJump(Token::Iter iter, OpCode code, OpCode dynamicCode)
+	{
+		// GOTO / GOSUB
+		++iter;
+
+		// <line>
+		Expression expression = CompileExpression(iter, m_End);
+
+		if (expression.postfix.size() == 1 && expression.postfix[0].IsNumeric())
+		{
+			// The line number is known so the jump is resolved at compile time
+			int position = Emit(code, 0, iter);
+			m_LineJumps.emplace_back(position, (int)m_Pool.GetNumber(expression.postfix[0]));
+
+			return iter + expression.length;
+		}
+
+		auto end = EmitExpression(iter);
+
+		if (end == iter)
+			throw Exception_Iter(iter, "Expected line number to be numeric");
+
+		Emit(dynamicCode, 0, iter);
+
+		return end;
+	}
+
+	// FOR <var> = <expr> TO <expr> [ STEP <expr> ]
+	Token::Iter Compiler::CompileFor(Token::Iter iter)
+	{
+		auto keyword = iter;
+
+		// FOR
+		++iter;
+
+		// <var>
+		if (iter == m_End || iter->type != Token::Type::Symbol)
+			throw Exception_Iter(iter, "Expected variable name");
+
+		int slot = iter->slot;
+		++iter;
+
+		// =
+		if (iter == m_End || iter->type != Token::Type::Operator || iter->op.type != Operator::Type::Assign)
+			throw Exception_Iter(iter, "Expected =");
+
+		++iter;
+
+		// <start expr>
+		auto end = EmitExpression(iter);
+
+		if (end == iter)
+			throw Exception_Iter(iter, "Start value must be numeric");
+
+		// TO
+		if (end == m_End || end->type != Token::Type::Keyword_To)
+			throw Exception_Iter(end, "Expected TO");
+
+		iter = end + 1;
+
+		// <end expr>
+		end = EmitExpression(iter);
+
+		if (end == iter)
+			throw Exception_Iter(iter, "End value must be numeric");
+
+		// STEP ?
+		if (end != m_End && end->type == Token::Type::Keyword_Step)
+		{
+			iter = end + 1;
+			end = EmitExpression(iter);
+
+			if (end == iter)
+				throw Exception_Iter(iter, "Step value must be numeric");
+		}
+		else
+			Emit(OpCode::PushConstant, AddConstant(Numeric{ 1.0 }), end);
+
+		Emit(OpCode::For, slot, keyword);
+
+		return end;
+	}
+
+	// NEXT [ <var> ]
+	Token::Iter Compiler::CompileNext(Token::Iter iter)
+	{
+		auto keyword = iter;
+
+		// NEXT
+		++iter;
+
+		int slot = -1;
+
+		// <?var>
+		if (iter != m_End && iter->type == Token::Type::Symbol)
+		{
+			slot = iter->slot;
+			++iter;
+		}
+
+		Emit(OpCode::Next, slot, keyword);
+
+		return iter;
+	}
+
+	// <name> = <expr>, <name>(<index>) = <expr>
+	Token::Iter Compiler::CompileAssignment(Token::Iter iter)
+	{
+		auto next = std::next(iter);
+
+		if (iter->type == Token::Type::Symbol && next != m_End && next->type == Token::Type::Parenthesis_Open)
+		{
+			int slot = iter->slot;
+
+			// (<index> [, <index> ...])
+			int count = 0;
+			iter = EmitIndices(next, count);
+
+			// =
+			if (iter == m_End || iter->type != Token::Type::Operator || iter->op.type != Operator::Type::Assign)
+				throw Exception_Iter(iter, "Expected = after array index");
+
+			// <expr>
+			auto end = EmitExpression(iter + 1);
+
+			if (end == iter + 1)
+				throw Exception_Iter(iter, "Expected expression");
+
+			Emit(OpCode::StoreElement, slot, iter, (Byte)count);
+
+			return end;
+		}
+
+		auto end = EmitExpression(iter, true);
+
+		if (end == iter)
+			throw Exception_Iter(iter, "Unexpected token: " + m_Pool.GetText(*iter));
+
+		return end;
+	}
+
+	Token::Iter Compiler::EmitIndices(Token::Iter iter, int& count)
+	{
+		// (
+		++iter;
+
+		while (true)
+		{
+			// <index>
+			auto end = EmitExpression(iter);
+
+			if (end == iter)
+				throw Exception_Iter(iter, "Array index must be numeric");
+
+			if (++count > std::numeric_limits<Byte>::max())
+				throw Exception_Iter(iter, "Too many array indices");
+
+			if (end != m_End && end->type == Token::Type::Comma)
+			{
+				iter = end + 1;
+				continue;
+			}
+
+			// )
+			if (end == m_End || end->type != Token::Type::Parenthesis_Close)
+				throw Exception_Iter(end, "Expected )");
+
+			return end + 1;
+		}
+	}
+
+	Token::Iter Compiler::CompileStatement(Token::Iter iter)
+	{
+		auto end = iter;
+
+		while (end != m_End && end->type != Token::Type::Colon && end->type != Token::Type::Keyword_Else)
+			++end;
+
+		Emit(OpCode::Statement, (int)std::distance(m_Line->tokens.cbegin(), end), iter);
+
+		return end;
+	}
+
+	Token::Iter Compiler::EmitExpression(Token::Iter iter, bool discard, int* resultSlot)
+	{
+		Expression expression = CompileExpression(iter, m_End);
+
+		if (resultSlot)
+			*resultSlot = Expression_ResultSlot(expression);
+
+		if (expression.postfix.empty())
+			return iter;
+
+		// Build the tree from the postfix notation so assignments and
+		// the order of evaluation are known before emitting instructions
+
+		std::vector<Node> nodes;
+		std::vector<int> roots;
+
+		for (const auto& token : expression.postfix)
+		{
+			// AND and OR emit their jumps by themselves
+			if (token.type == Token::Type::ShortCircuit)
+				continue;
+
+			Node node;
+			node.token = &token;
+
+			if (token.type == Token::Type::Operator)
+				node.arguments = token.op.arguments;
+			else if (token.type == Token::Type::Subscript || token.IsReduction())
+				node.arguments = token.op.arguments;
+			else if (token.IsFunction() && token.type != Token::Type::Keyword_Random)
+				node.arguments = 1;
+
+			if ((int)roots.size() < node.arguments)
+			{
+				if (token.type == Token::Type::Operator)
+					throw Exception_Iter(iter, "Not enough arguments for the operator: " + m_Pool.GetText(token));
+
+				throw Exception_Iter(iter, "Not enough arguments: " + m_Pool.GetText(token) + " <arg>");
+			}
+
+			node.children.assign(roots.end() - node.arguments, roots.end());
+			roots.resize(roots.size() - node.arguments);
+
+			node.type = TypeOf(nodes, node);
+
+			nodes.push_back(node);
+			roots.push_back((int)nodes.size() - 1);
+		}
+
+		// Only the last value is the result of the expression
+		for (size_t i = 0; i < roots.size(); i++)
+			EmitNode(nodes, roots[i], i + 1 == roots.size() && !discard, iter);
+
+		return iter + expression.length;
+	}
+
+	void Compiler::EmitNode(const std::vector<Node>& nodes, int index, bool keep, Token::Iter source)
+	{
+		const Node& node = nodes[index];
+		const Token& token = *node.token;
+
+		switch (token.type)
+		{
+		case Token::Type::Literal_NumericBase10:
+		case Token::Type::Literal_NumericBase16:
+		case Token::Type::Literal_NumericBase8:
+		case Token::Type::Literal_NumericBase2:
+			Emit(OpCode::PushConstant, AddConstant(Numeric{ m_Pool.GetNumber(token) }), source);
+		break;
+
+		case Token::Type::Literal_String:
+			Emit(OpCode::PushConstant, AddConstant(m_Pool.GetString(token)), source);
+		break;
+
+		case Token::Type::Symbol:
+			Emit(OpCode::Load, token.slot, source);
+		break;
+
+		case Token::Type::Subscript:
+		{
+			for (int child : node.children)
+				EmitNode(nodes, child, true, source);
+
+			Emit(OpCode::LoadElement, token.slot, source, (Byte)node.arguments);
+		}
+		break;
+
+		case Token::Type::Operator:
+		{
+			const Operator& op = token.op;
+
+			if (op.type == Operator::Type::Assign)
+			{
+				const Node& target = nodes[node.children[0]];
+
+				if (target.token->type != Token::Type::Symbol)
+					throw Exception_Iter(source, "Can't create variable with invalid name");
+
+				EmitNode(nodes, node.children[1], true, source);
+
+				if (keep)
+					Emit(OpCode::Duplicate, 0, source);
+
+				Emit(OpCode::Store, target.token->slot, source);
+
+				// The value is either duplicated or not needed
+				return;
+			}
+
+			int jump = -1;
+
+			for (int i = 0; i < node.arguments; i++)
+			{
+				EmitNode(nodes, node.children[i], true, source);
+
+				// The right operand is skipped if the left one decides the result
+				if (i == 0 && node.arguments == 2 && (op.type == Operator::Type::And || op.type == Operator::Type::Or))
+					jump = Emit(OpCode::ShortCircuit, 0, source, (Byte)op.type);
+			}
+
+			OpCode code = node.arguments == 1 ? OpCode::Unary : OpCode::Binary;
+
+			// Types of the operands are known so the operator doesn't have to check them
+			if (node.arguments == 2 && node.type == ValueType::Numeric)
+			{
+				bool integers = nodes[node.children[0]].type == ValueType::Integer && nodes[node.children[1]].type == ValueType::Integer;
+
+				if (integers && op.type != Operator::Type::Division && op.type != Operator::Type::Power)
+					code = OpCode::BinaryInteger;
+				else
+					code = OpCode::BinaryNumeric;
+			}
+
+			Emit(code, (int)op.type, source);
+
+			if (jump != -1)
+				m_Bytecode.code[jump].operand = (int)m_Bytecode.code.size();
+		}
+		break;
+
+		default:
+		{
+			for (int child : node.children)
+				EmitNode(nodes, child, true, source);
+
+			if (token.IsReduction())
+				Emit(OpCode::Reduce, (int)token.type, source, (Byte)node.arguments);
+			else
+				Emit(OpCode::Call, (int)token.type, source);
+		}
+		break;
+
+		}
+
+		if (!keep)
+			Emit(OpCode::Pop, 0, source);
+	}
+
+	Compiler::ValueType Compiler::TypeOf(const std::vector<Node>& nodes, const Node& node) const
+	{
+		const Token& token = *node.token;
+
+		auto IsNumber = [&](int child)
+			{
+				ValueType type = nodes[node.children[child]].type;
+				return type == ValueType::Numeric || type == ValueType::Integer;
+			};
+
+		switch (token.type)
+		{
+		case Token::Type::Literal_String:
+			return ValueType::String;
+
+		case Token::Type::Symbol:
+		{
+			switch (VarType_FromName(m_Pool.GetText(token)))
+			{
+			case VarType::Integer: return ValueType::Integer;
+			case VarType::Single:
+			case VarType::Double:  return ValueType::Numeric;
+			case VarType::String:  return ValueType::String;
+			default:               return ValueType::Unknown;
+			}
+		}
+
+		// Arrays can hold only numbers
+		case Token::Type::Subscript:
+			return VarType_FromName(m_Pool.GetText(token)) == VarType::Integer ? ValueType::Integer : ValueType::Numeric;
+
+		case Token::Type::Operator:
+		{
+			if (token.op.type == Operator::Type::Assign)
+				return nodes[node.children[1]].type;
+
+			if (node.arguments == 1)
+				return IsNumber(0) ? ValueType::Numeric : ValueType::Unknown;
+
+			return IsNumber(0) && IsNumber(1) ? ValueType::Numeric : ValueType::Unknown;
+		}
+
+		default:
+		{
+			if (token.IsNumeric())
+			{
+				Real value = m_Pool.GetNumber(token);
+
+				if (VARINT_MIN <= value && value <= VARINT_MAX && value == (Real)(Integer)value)
+					return ValueType::Integer;
+
+				return ValueType::Numeric;
+			}
+
+			if (token.type == Token::Type::Keyword_Str)
+				return ValueType::String;
+
+			// The rest of the functions return numbers
+			if (token.IsFunction())
+				return ValueType::Numeric;
+
+			return ValueType::Unknown;
+		}
+
+		}
+	}
+
+	int Compiler::Emit(OpCode code, int operand, Token::Iter source, Byte arguments)
+	{
+		m_Bytecode.code.push_back(Instruction{ code, arguments, operand });
+		m_Bytecode.sources.push_back(SourceLocation{ m_Line, (int)std::distance(m_Line->tokens.cbegin(), source) });
+
+		return (int)m_Bytecode.code.size() - 1;
+	}
+
+	int Compiler::AddConstant(const Object& value)
+	{
+		m_Bytecode.constants.push_back(value);
+		return (int)m_Bytecode.constants.size() - 1;
+	}
+}
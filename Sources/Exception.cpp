@@ -2,7 +2,7 @@
 
 namespace Basic
 {
-    Exception::Exception(const std::string& line, int pos, const std::string& message)
+    Exception::Exception(std::string_view line, int pos, const std::string& message)
 	{
         std::stringstream ss;
 
@@ -1,4 +1,7 @@
 #include "../Include/Interpreter.hpp"
+#include "../Include/Compiler.hpp"
+#include "../Include/Kernels.hpp"
+#include "../Include/Tokenised.hpp"
 
 #include <iostream>
 #include <thread>
@@ -6,6 +9,7 @@
 #include <cmath>
 #include <fstream>
 #include <functional>
+#include <iterator>
 
 namespace Basic
 {
@@ -19,59 +23,144 @@ namespace Basic
         return !s1.empty() && !s2.empty();
     }
 
+    void ExpressionCache::Reset(size_t tokensCount)
+    {
+        entries.clear();
+
+        // One more entry for an expression that starts at the end of the line
+        entries.resize(tokensCount + 1);
+        elseTargets.assign(tokensCount, -1);
+
+        formats.clear();
+        formats.resize(tokensCount);
+    }
+
+    Line::Line(std::vector<Token>&& tokens) : tokens(std::move(tokens))
+    {
+        cache.Reset(this->tokens.size());
+    }
+
+    static bool IsIntegral(Real value)
+    {
+        // Bigger values can't be counted exactly anyway
+        return std::fabs(value) < INTEGRAL_LIMIT && (Real)(Integer)value == value;
+    }
+
+    // Indices that don't fit into Integer are reported as out of bounds
+    static Integer ToIndex(Real value)
+    {
+        return std::fabs(value) < INTEGRAL_LIMIT ? (Integer)value : -1;
+    }
+
+    LoopCounter::LoopCounter(Real start, Real end, Real step) : endValue(end), step(step)
+    {
+        integral = IsIntegral(start) && IsIntegral(end) && IsIntegral(step);
+
+        if (integral)
+        {
+            count = (Integer)start;
+            intEnd = (Integer)end;
+            intStep = (Integer)step;
+        }
+    }
+
+    bool LoopCounter::Step(Real& variable)
+    {
+        // The variable could be changed inside of the loop
+        if (integral && variable != (Real)count)
+        {
+            integral = IsIntegral(variable);
+            count = (Integer)variable;
+        }
+
+        if (integral)
+        {
+            count += intStep;
+            variable = (Real)count;
+
+            return !((intStep > 0 && count > intEnd) || (intStep < 0 && count < intEnd));
+        }
+
+        variable += step;
+
+        return !((step > 0 && variable > endValue) || (step < 0 && variable < endValue));
+    }
+
+    int ProgrammImage::Find(int number) const
+    {
+        auto it = std::lower_bound(numbers.begin(), numbers.end(), number);
+
+        if (it == numbers.end() || *it != number)
+            return (int)numbers.size();
+
+        return (int)std::distance(numbers.begin(), it);
+    }
+
 	// Returns result of expression and position of next token after end of expression
     std::pair<Object, Token::Iter> Interpreter::ParseExpression(Token::Iter iter)
+	{
+		auto& entry = m_Cache->entries[std::distance(m_Begin, iter)];
+
+		// The expression is converted only once per line
+		if (!entry)
+			entry = CompileExpression(iter, m_End);
+
+		return std::make_pair(EvaluateExpression(*entry, iter), iter + entry->length);
+	}
+
+	int Expression_ResultSlot(const Expression& expression)
+	{
+		if (expression.postfix.empty())
+			return -1;
+
+		const Token& root = expression.postfix.back();
+
+		return root.type == Token::Type::Symbol || root.type == Token::Type::Subscript ? root.slot : -1;
+	}
+
+	Expression CompileExpression(Token::Iter iter, Token::Iter end)
 	{
 		// Using Shunting yard algorithm
 
-		std::deque<Token> holding, output;
-		std::deque<Object> solving;
+		Expression expression;
 
-		Token prev(Token::Type::None);
+		std::vector<Token> holding;
+		std::vector<Token>& output = expression.postfix;
+
+		// Number of open parentheses in the holding stack
+		int depth = 0;
 
 		auto token = iter;
 		bool stop = false;
 
-		for (; token != m_End; ++token)
+		for (; token != end; ++token)
 		{
 			switch (token->type)
 			{
 			case Token::Type::Literal_NumericBase10:
 			case Token::Type::Literal_NumericBase16:
+			case Token::Type::Literal_NumericBase8:
 			case Token::Type::Literal_NumericBase2:
 			case Token::Type::Literal_String:
-                holding.push_back(*token);
+                output.push_back(*token);
                 break;
 
             case Token::Type::Symbol:
             {
-                std::string name = token->value;
-
                 auto next = std::next(token);
 
-                // Check if it's an array access
-                if (next != m_End && next->type == Token::Type::Parenthesis_Open)
+                // Check if it's an array access, the index is
+                // handled the same way as an argument of a function
+                if (next != end && next->type == Token::Type::Parenthesis_Open)
                 {
-                    Token::Iter it = next;
+                    Token subscript = *token;
+                    subscript.type = Token::Type::Subscript;
+                    subscript.op.arguments = 1;
 
-                    int index = ParseArrayIndex(it);
-
-                    const auto value = m_Variables.Get(name);
-
-                    if (!value || !std::holds_alternative<Array>(value.value().get()))
-                        throw Exception_Iter(iter, "Variable is not an array");
-
-                    Array& arr = std::get<Array>(value.value().get());
-
-                    if (index < 0 || index >= (int)arr.value.size())
-                        throw Exception_Iter(iter, "Array index out of bounds");
-
-                    solving.push_back(Object(arr.value[index]));
-
-                    token = it - 1;
+                    holding.push_back(subscript);
                 }
                 else
-                    solving.push_back(Object(Symbol{ name }));
+                    output.push_back(*token);
             }
 			break;
 
@@ -89,20 +178,55 @@ namespace Basic
 			case Token::Type::Keyword_Step:
 			case Token::Type::Keyword_Next:
 			case Token::Type::Keyword_Sleep:
+            case Token::Type::Keyword_End:
             case Token::Type::Keyword_GoSub:
             case Token::Type::Keyword_Return:
             case Token::Type::Keyword_List:
             case Token::Type::Keyword_Run:
             case Token::Type::Keyword_New:
             case Token::Type::Keyword_Load:
+            case Token::Type::Keyword_Save:
 		    case Token::Type::Keyword_Dim:
+		    case Token::Type::Keyword_DefInt:
+		    case Token::Type::Keyword_DefSng:
+		    case Token::Type::Keyword_DefDbl:
+		    case Token::Type::Keyword_DefStr:
+		    case Token::Type::Keyword_Mat:
+		    case Token::Type::Keyword_Sort:
+		    case Token::Type::Keyword_Option:
+		    case Token::Type::Keyword_Flush:
 		    case Token::Type::Semicolon:
 		    case Token::Type::Colon:
-		    case Token::Type::Comma:
             case Token::Type::Bracket_Close:
 				stop = true;
 				break;
 
+			case Token::Type::Comma:
+			{
+				// Comma separates indices if it's inside of the parentheses of an array
+				// and arguments if it's inside of the parentheses of a reduction
+				size_t open = holding.size();
+
+				while (open > 0 && holding[open - 1].type != Token::Type::Parenthesis_Open)
+					open--;
+
+				if (open < 2 || (holding[open - 2].type != Token::Type::Subscript && !holding[open - 2].IsReduction()))
+				{
+					stop = true;
+					break;
+				}
+
+				// Previous index is complete
+				while (holding.size() > open)
+				{
+					output.push_back(holding.back());
+					holding.pop_back();
+				}
+
+				holding[open - 2].op.arguments++;
+			}
+			break;
+
 			case Token::Type::Keyword_Sin:
 			case Token::Type::Keyword_Cos:
 			case Token::Type::Keyword_Tan:
@@ -117,115 +241,101 @@ namespace Basic
 			case Token::Type::Keyword_Sign:
 			case Token::Type::Keyword_Int:
             case Token::Type::Keyword_Random:
-            case Token::Type::Keyword_End:
             case Token::Type::Keyword_Val:
+            case Token::Type::Keyword_Str:
+				holding.push_back(*token);
+				break;
+
+			case Token::Type::Keyword_Sum:
+			case Token::Type::Keyword_Dot:
+			case Token::Type::Keyword_MinA:
+			case Token::Type::Keyword_MaxA:
+			case Token::Type::Keyword_Mean:
 				holding.push_back(*token);
+				holding.back().op.arguments = 1;
 				break;
 
 			case Token::Type::Operator:
 			{
-				Operator op = Parser::s_Operators[token->value];
+				const Operator& op = token->op;
 
-				Token tok = *token;
-
-				// Check for an unary operator
-				if (tok.value == "+" || tok.value == "-")
+				// Unary operator doesn't have a left operand
+				// so there is nothing to drain yet
+				if (op.arguments == 1)
 				{
-					constexpr std::array<Token::Type, 7> excluded =
-					{
-						Token::Type::Literal_NumericBase16,
-						Token::Type::Literal_NumericBase10,
-						Token::Type::Literal_NumericBase8,
-						Token::Type::Literal_NumericBase2,
-						Token::Type::Literal_String,
-						Token::Type::Symbol,
-						Token::Type::Parenthesis_Close
-					};
-
-					bool notExcluded = std::find(excluded.begin(), excluded.end(), prev.type) == excluded.end();
-
-					if (notExcluded || prev.type == Token::Type::None)
-					{
-						// It is easier to handle unary operators as u+ or u-
-						tok.value = "u" + tok.value;
-					}
+					holding.push_back(*token);
+					break;
 				}
 
 				// Drain the stack out to the output stack until there's nothing to take or
 				// the precedence of the current token is less than the precedence of the top-stack token
                 while (!holding.empty())
                 {
-                    Token tok = holding.back();
+                    const Token& top = holding.back();
 
                     // If top is a function token, it has highest precedence
-                    if (tok.IsFunction())
+                    if (top.IsFunction() || top.type == Token::Type::Subscript)
                     {
-                        output.push_back(tok);
+                        output.push_back(top);
                         holding.pop_back();
                         continue;
                     }
 
                     // For regular operators, check precedence
-                    if (tok.type != Token::Type::Parenthesis_Open &&
-                        op.precedence <= Parser::s_Operators[tok.value].precedence)
+                    if (top.type != Token::Type::Parenthesis_Open && op.precedence <= top.op.precedence)
                     {
-                        output.push_back(tok);
+                        output.push_back(top);
                         holding.pop_back();
                     }
                     else
                         break;
                 }
 
+				// Left operand of AND or OR is complete so its value can be checked
+				// before the right one, the target is set when the operator is in the output
+				if (op.type == Operator::Type::And || op.type == Operator::Type::Or)
+				{
+					Token jump = *token;
+					jump.type = Token::Type::ShortCircuit;
+					output.push_back(jump);
+				}
+
 				// ... only then append current token to the holding stack
-				holding.push_back(tok);
+				holding.push_back(*token);
 			}
 			break;
 
 			case Token::Type::Parenthesis_Open:
 				holding.push_back(*token);
+				depth++;
 				break;
 
 			case Token::Type::Parenthesis_Close:
 			{
-				// Check if there's a matching open paren in the holding stack
-				bool hasMatchingOpenParen = false;
-
-				for (auto it = holding.rbegin(); it != holding.rend(); ++it)
-				{
-					if (it->type == Token::Type::Parenthesis_Open)
-					{
-						hasMatchingOpenParen = true;
-						break;
-					}
-				}
-
-				if (!hasMatchingOpenParen)
+				if (depth == 0)
 				{
 					// No matching open paren, this closing paren is for array indexing
 					stop = true;
+					break;
 				}
-				else
+
+				// Drain the holding stack out until an open parenthesis
+				while (holding.back().type != Token::Type::Parenthesis_Open)
 				{
-					// Drain the holding stack out until an open parenthesis
-					while (!holding.empty() && holding.back().type != Token::Type::Parenthesis_Open)
-					{
-						output.push_back(holding.back());
-						holding.pop_back();
-					}
+					output.push_back(holding.back());
+					holding.pop_back();
+				}
 
-					// And remove the parenthesis by itself
-					if (!holding.empty())
-					{
-						holding.pop_back();
+				// And remove the parenthesis by itself
+				holding.pop_back();
+				depth--;
 
-						// If the token before the open parenthesis was a function
-						// then add it to the output now
-						if (!holding.empty() && holding.back().IsFunction())
-						{
-							output.push_back(holding.back());
-							holding.pop_back();
-						}
-					}
+				// If the token before the open parenthesis was a function
+				// or an array name then add it to the output now
+				if (!holding.empty() && (holding.back().IsFunction() || holding.back().type == Token::Type::Subscript))
+				{
+					output.push_back(holding.back());
+					holding.pop_back();
 				}
 			}
 			break;
@@ -233,255 +343,184 @@ namespace Basic
 			// Bracket_Open and Bracket_Close are NOT handled here!
 			// They are handled by HandleDim, HandleLet, etc.
 
-			default: /* Unreachable */ break;
+			default:
+				stop = true;
+				break;
 
 			}
 
 			if (stop)
 				break;
-
-			prev = *token;
 		}
 
 		// Drain out the holding stack at the end
 		while (!holding.empty())
 		{
-			output.push_back(holding.back());
+			if (holding.back().type != Token::Type::Parenthesis_Open)
+				output.push_back(holding.back());
+
 			holding.pop_back();
 		}
 
-        auto ApplyFunc = [&](std::function<long double(long double)> func, const std::string& signature, Real bottom, Real top)
-            {
-                if (solving.empty())
-                    throw Exception_Iter(iter, "Not enough arguments: " + signature + " <arg>");
+		// Operands are nested so every AND or OR belongs to the latest short circuit without an operator
+		std::vector<int> jumps;
+
+		for (int i = 0; i < (int)output.size(); i++)
+		{
+			if (output[i].type == Token::Type::ShortCircuit)
+				jumps.push_back(i);
+			else if (output[i].type == Token::Type::Operator && output[i].op.arguments == 2 && !jumps.empty() &&
+				(output[i].op.type == Operator::Type::And || output[i].op.type == Operator::Type::Or))
+			{
+				output[jumps.back()].target = i;
+				jumps.pop_back();
+			}
+		}
 
-                if (!std::holds_alternative<Numeric>(solving.back()))
-                    throw Exception_Iter(iter, "Argument must be numeric: " + signature + " <arg>");
+		expression.length = (int)std::distance(iter, token);
 
-                Real value = std::get<Numeric>(solving.back()).value;
+		return expression;
+	}
 
-                if (value < bottom || value > top)
-                    throw Exception_Iter(iter, "Argument must be within the range: [" + std::to_string(bottom) + ", " + std::to_string(top) + "]");
+	Object Interpreter::EvaluateExpression(const Expression& expression, Token::Iter iter)
+	{
+		// The stack is reused so evaluation doesn't allocate
+		std::vector<Object>& solving = m_Solving;
+		solving.clear();
 
-                solving.pop_back();
-                solving.push_back(Numeric{ func(value) });
-            };
+		const auto& postfix = expression.postfix;
 
-		for (const auto& token : output)
+		for (size_t i = 0; i < postfix.size(); i++)
 		{
+			const Token& token = postfix[i];
+
 			switch (token.type)
 			{
-            case Token::Type::Literal_NumericBase10: solving.push_back(Object(Numeric{ std::stold(token.value) })); break;
-			case Token::Type::Literal_NumericBase16: solving.push_back(Object(Numeric{ (Real)std::stoll(token.value, nullptr, 16) })); break;
-			case Token::Type::Literal_NumericBase2:  solving.push_back(Object(Numeric{ (Real)std::stoll(token.value, nullptr, 2) })); break;
+            case Token::Type::Literal_NumericBase10:
+			case Token::Type::Literal_NumericBase16:
+			case Token::Type::Literal_NumericBase8:
+			case Token::Type::Literal_NumericBase2:
+				solving.push_back(Object(Numeric{ m_Pool.GetNumber(token) }));
+			break;
 
 			case Token::Type::Literal_String:
-				solving.push_back(Object(String{ token.value }));
+				solving.push_back(m_Pool.GetString(token));
 			break;
 
 			case Token::Type::Symbol:
-				solving.push_back(Object(Symbol{ token.value }));
+				solving.push_back(Object(Symbol{ token.slot }));
 			break;
 
-			case Token::Type::Operator:
+			case Token::Type::Subscript:
 			{
-				const auto& op = Parser::s_Operators[token.value];
+				const int count = token.op.arguments;
+
+				if ((int)solving.size() < count)
+					throw Exception_Iter(iter, "Expected array index");
+
+				Object element = LoadElement(token.slot, &solving[solving.size() - count], count, iter);
+
+				solving.resize(solving.size() - count);
+				solving.push_back(element);
+			}
+			break;
 
-				std::vector<Object> arguments(op.arguments);
+			case Token::Type::Operator:
+			{
+				const auto& op = token.op;
 
 				// Save all operator arguments if there is enough of them on the stack
 				if (solving.size() < op.arguments)
-                    throw Exception_Iter(iter, "Not enough arguments for the operator: " + token.value);
-
-				for (auto& arg : arguments)
-				{
-				    arg = solving.back();
-					solving.pop_back();
-				}
+                    throw Exception_Iter(iter, "Not enough arguments for the operator: " + m_Pool.GetText(token));
 
 				Object object;
 
-				switch (op.arguments)
-				{
-				case 1:
+				if (op.arguments == 1)
+					object = ApplyUnary(op.type, solving.back(), iter);
+				else
 				{
-					// Handle unary operators
-                    Real number = UnwrapValue<Numeric>(iter, arguments[0], "Can't apply unary operator to non-numeric value");
+					const Object& lhs = solving[solving.size() - 2];
+					const Object& rhs = solving.back();
 
-					switch (op.type)
+					if (op.type == Operator::Type::Assign)
 					{
-					case Operator::Type::Subtraction: object = Numeric{ -number }; break;
-					case Operator::Type::Addition:    object = Numeric{ +number }; break;
-                    default: /* Unreachable */ break;
-                    }
-				}
-				break;
-
-				case 2:
-				{
-					// Handle binary operators
-
-                    switch (op.type)
-                    {
-                    case Operator::Type::Equals:
-                    case Operator::Type::NotEquals:
-                    case Operator::Type::Less:
-                    case Operator::Type::Greater:
-                    case Operator::Type::LessEquals:
-                    case Operator::Type::GreaterEquals:
-                    {
-                        auto Compare = [&](auto comparator)
-                        {
-                            auto CheckTypes = [&]<class T>(const std::string& name)
-                            {
-                                if (std::holds_alternative<T>(arguments[1]) || std::holds_alternative<Symbol>(arguments[1]))
-                                {
-                                    std::string error = "Expected " + name;
-
-                                    const auto lhs = UnwrapValue<T>(iter, arguments[1], error);
-                                    const auto rhs = UnwrapValue<T>(iter, arguments[0], error);
-
-                                    object = Numeric{ (Real)comparator(lhs, rhs) };
-                                    return true;
-                                }
-
-                                return false;
-                            };
-
-                            if (CheckTypes.template operator()<String>("string") || CheckTypes.template operator()<Numeric>("number"))
-                                return;
-
-                            throw Exception_Iter(iter, "Can't compare 2 values");
-                        };
-
-                        if (op.type == Operator::Type::Equals)
-                            Compare(std::equal_to<>());
-                        else if (op.type == Operator::Type::NotEquals)
-                            Compare(std::not_equal_to<>());
-                        else if (op.type == Operator::Type::Less)
-                            Compare(std::less<>());
-                        else if (op.type == Operator::Type::Greater)
-                            Compare(std::greater<>());
-                        else if (op.type == Operator::Type::LessEquals)
-                            Compare(std::less_equal<>());
-                        else if (op.type == Operator::Type::GreaterEquals)
-                            Compare(std::greater_equal<>());
-                    }
-                    break;
-
-                    case Operator::Type::And:
-                    {
-                        auto lhs = UnwrapValue<Numeric>(iter, arguments[1], "Expected number");
-                        auto rhs = UnwrapValue<Numeric>(iter, arguments[0], "Expected number");
-                        object = Numeric{ (Real)((lhs != 0) && (rhs != 0)) };
-                    }
-                    break;
-
-                    case Operator::Type::Or:
-                    {
-                        auto lhs = UnwrapValue<Numeric>(iter, arguments[1], "Expected number");
-                        auto rhs = UnwrapValue<Numeric>(iter, arguments[0], "Expected number");
-                        object = Numeric{ (Real)((lhs != 0) || (rhs != 0)) };
-                    }
-                    break;
-
-                    case Operator::Type::Assign:
-                    {
-                        if (!std::holds_alternative<Symbol>(arguments[1]))
-                            throw Exception_Iter(iter, "Can't create variable with invalid name");
-
-                        Object& value = arguments[0];
+						if (!std::holds_alternative<Symbol>(lhs))
+							throw Exception_Iter(iter, "Can't create variable with invalid name");
 
-                        if (std::holds_alternative<Symbol>(arguments[0]))
-                        {
-                            auto var = m_Variables.Get(std::get<Symbol>(arguments[0]).value);
+						object = rhs;
 
-                            if (var)
-                                value = *var;
-                        }
+						if (std::holds_alternative<Symbol>(rhs))
+						{
+							auto var = m_Variables.Get(std::get<Symbol>(rhs).value);
 
-                        m_Variables.Set(
-                            std::get<Symbol>(arguments[1]).value,
-                            value
-                        );
+							if (var)
+								object = *var;
+						}
 
-                        object = value;
-                    }
-                    break;
+						Assign(std::get<Symbol>(lhs).value, object, iter);
+					}
+					else
+						object = ApplyBinary(op.type, lhs, rhs, iter);
+				}
 
-                    default:
-                    {
-                        const auto lhs = UnwrapValue(iter, arguments[1]);
-                        const auto rhs = UnwrapValue(iter, arguments[0]);
+				solving.resize(solving.size() - op.arguments);
+                solving.push_back(object);
+			}
+			break;
 
-                        if (std::holds_alternative<Numeric>(lhs) && std::holds_alternative<Numeric>(rhs))
-                        {
-                            Real lhsVal = std::get<Numeric>(lhs).value;
-                            Real rhsVal = std::get<Numeric>(rhs).value;
+			case Token::Type::ShortCircuit:
+			{
+				if (!m_ShortCircuit || solving.empty())
+					break;
 
-                            switch (op.type)
-                            {
-                            case Operator::Type::Subtraction:    object = Numeric{ lhsVal - rhsVal };     break;
-                            case Operator::Type::Addition:       object = Numeric{ lhsVal + rhsVal };     break;
-                            case Operator::Type::Multiplication: object = Numeric{ lhsVal * rhsVal };     break;
-                            case Operator::Type::Division:       object = Numeric{ lhsVal / rhsVal };     break;
-                            case Operator::Type::Power:          object = Numeric{ pow(lhsVal, rhsVal) }; break;
-                            default: /* Unreachable */ break;
-                            }
-                        }
-                        else if (std::holds_alternative<String>(lhs) && std::holds_alternative<String>(rhs))
-                        {
-                            std::string lhsVal = std::get<String>(lhs).value;
-                            std::string rhsVal = std::get<String>(rhs).value;
+				const Object& lhs = UnwrapValue(iter, solving.back());
 
-                            if (op.type == Operator::Type::Addition) object = String{ lhsVal + rhsVal };
-                            else throw Exception_Iter(iter+1, "Can only concatenate strings");
-                        }
-                        else
-                            throw Exception_Iter(iter+1, "Can't perform binary operations on values with different types");
-                    }
+				// Strings are left to the operator to report the error
+				if (!std::holds_alternative<Numeric>(lhs))
+					break;
 
-                    };
+				const bool value = std::get<Numeric>(lhs).value != 0.0;
 
+				if (value == (token.op.type == Operator::Type::Or))
+				{
+					solving.back() = Numeric{ value ? 1.0 : 0.0 };
+					i = token.target;
 				}
-				}
-
-                solving.push_back(object);
 			}
 			break;
 
-            case Token::Type::Keyword_Sin:     ApplyFunc(static_cast<Real(*)(Real)>(&sin), "SIN", Numeric::MIN, Numeric::MAX); break;
-            case Token::Type::Keyword_Cos:     ApplyFunc(static_cast<Real(*)(Real)>(&cos), "COS", Numeric::MIN, Numeric::MAX); break;
-            case Token::Type::Keyword_Tan:     ApplyFunc(static_cast<Real(*)(Real)>(&tan), "TAN", Numeric::MIN, Numeric::MAX); break;
+			case Token::Type::Keyword_Random:
+				solving.push_back(Numeric{ (Real)rand() / (Real)RAND_MAX });
+			break;
 
-            case Token::Type::Keyword_ArcSin:  ApplyFunc(static_cast<Real(*)(Real)>(&asin), "ARCSIN", -1.0, 1.0); break;
-            case Token::Type::Keyword_ArcCos:  ApplyFunc(static_cast<Real(*)(Real)>(&acos), "ARCCOS", -1.0, 1.0); break;
-            case Token::Type::Keyword_ArcTan:  ApplyFunc(static_cast<Real(*)(Real)>(&atan), "ARCTAN", -3.145926535 * 0.5, 3.145926535 * 0.5); break;
+			default:
+			{
+				if (!token.IsFunction())
+					break;
 
-            case Token::Type::Keyword_Log:     ApplyFunc(static_cast<Real(*)(Real)>(&log10), "LOG", Numeric::EPS, Numeric::MAX); break;
-            case Token::Type::Keyword_Ln:      ApplyFunc(static_cast<Real(*)(Real)>(&log), "LN", Numeric::EPS, Numeric::MAX); break;
-            case Token::Type::Keyword_Exp:     ApplyFunc(static_cast<Real(*)(Real)>(&exp), "EXP", Numeric::MIN, Numeric::MAX); break;
-            case Token::Type::Keyword_Abs:     ApplyFunc(static_cast<Real(*)(Real)>(&fabs), "ABS", Numeric::MIN, Numeric::MAX); break;
-            case Token::Type::Keyword_Sign:    ApplyFunc(Real_Sign, "SIGN", Numeric::MIN, Numeric::MAX); break;
-            case Token::Type::Keyword_Int:     ApplyFunc(static_cast<Real(*)(Real)>(&trunc), "INT", Numeric::MIN, Numeric::MAX); break;
+				if (token.IsReduction())
+				{
+					const int count = token.op.arguments;
 
-            case Token::Type::Keyword_Val:
-            {
-                if (solving.empty())
-                    throw Exception_Iter(iter + 1, "Not enough arguments: VAL <arg>");
+					if ((int)solving.size() < count)
+						throw Exception_Iter(iter, "Not enough arguments: " + m_Pool.GetText(token) + " <array>");
 
-                std::string value = UnwrapValue<String>(iter + 1, solving.back(), "Argument must be string: VAL <arg>");
+					Object object = ApplyReduction(token.type, &solving[solving.size() - count], count, iter);
 
-                solving.pop_back();
-                solving.push_back(Numeric { std::stold(value) });
-            }
-            break;
+					solving.resize(solving.size() - count);
+					solving.push_back(object);
+					break;
+				}
 
-			case Token::Type::Keyword_Random:
-				solving.push_back(Numeric{ (Real)rand() / (Real)RAND_MAX });
+				if (solving.empty())
+					throw Exception_Iter(iter, "Not enough arguments: " + m_Pool.GetText(token) + " <arg>");
+
+				Object object = ApplyFunction(token.type, solving.back(), iter);
+
+				solving.pop_back();
+				solving.push_back(object);
+			}
 			break;
-                    
-            default: /* Unreachable */ break;
 
 			}
 
@@ -490,103 +529,510 @@ namespace Basic
 		if (solving.empty())
 		{
 			// Nothing has been evaluated
-			return std::make_pair(Object(), token);
+			return Object();
 		}
 
-		Object obj = solving.back();
+		Object obj = std::move(solving.back());
+		solving.clear();
 
 		// Possibly could be a variable name so let's extract a value from it
 		if (std::holds_alternative<Symbol>(obj))
 		{
-            std::string name = std::get<Symbol>(obj).value;
+            int slot = std::get<Symbol>(obj).value;
 
-			auto value = m_Variables.Get(name);
+			auto value = m_Variables.Get(slot);
 
             if (value)
                 obj = *value;
             else
-                throw Exception_Iter(iter, "No such variable \"" + name + "\"");
+                throw Exception_Iter(iter, "No such variable \"" + m_Variables.GetName(slot) + "\"");
 		}
 
-		return std::make_pair(obj, token);
+		return obj;
 	}
 
-    void Interpreter::Reset()
-    {
-        m_NextLine = -1;
-        m_LineOffset = 0;
+	size_t Interpreter::ElementOffset(const Array& arr, const Object* indices, int count, Token::Iter iter)
+	{
+		const std::vector<int>& sizes = *arr.sizes;
 
-        m_Cursor = Token::Iter();
-        m_End = Token::Iter();
+		if (count != (int)sizes.size())
+			throw Exception_Iter(iter, "Expected " + std::to_string(sizes.size()) + " array indices");
 
-        m_ForStack.clear();
-        m_SkipElse = true;
-    }
+		size_t offset = 0;
+		bool inside = true;
 
-    Exception GenerateException(const std::vector<Basic::Token>& tokens, const std::string& input, const Basic::Exception_Iter& exception)
-    {
-        int pos = 0;
+		for (int i = 0; i < count; i++)
+		{
+			// Negative indices become too big to be inside
+			size_t index = (size_t)ToIndex(UnwrapValue<Numeric>(iter, indices[i], "Array index must be numeric"));
 
-        for (auto it = tokens.begin(); it != exception.iterator; ++it)
-            pos += it->value.length() + 1;
+			inside &= index < (size_t)sizes[i];
+			offset = offset * sizes[i] + index;
+		}
 
-        return Basic::Exception(input, pos + 1, exception.message);
-    }
+		if (!inside)
+			throw Exception_Iter(iter, "Array index out of bounds");
 
-    bool Interpreter::RunLine(const std::vector<Token>& tokens, int lineNumber)
-    {
-        if (tokens.empty())
-            return false;
+		return offset;
+	}
 
-        bool programmMode = lineNumber > 0;
+	const Array& Interpreter::GetArray(int slot, Token::Iter iter)
+	{
+		const auto value = m_Variables.Get(slot);
 
-        // If the first token in a string is decimal then it must be a line number
-        // so we don't want to execute our programm, we just want to save the line
-        if (!programmMode && m_LineOffset == 0 && tokens[0].type == Token::Type::Literal_NumericBase10)
-        {
-            int line = std::stoi(tokens[0].value);
+		if (!value || !std::holds_alternative<Array>(value.value().get()))
+			throw Exception_Iter(iter, "Variable is not an array");
 
-            if (line < 0)
-                throw Exception_Iter(tokens.begin() + 1, "Invalid line number");
+		return std::get<Array>(value.value().get());
+	}
 
-            m_Programm[line] = std::vector<Token>(tokens.begin() + 1, tokens.end());
+	Object Interpreter::LoadElement(int slot, const Object* indices, int count, Token::Iter iter)
+	{
+		const Array& arr = GetArray(slot, iter);
 
-            return true;
-        }
+		return (*arr.value)[ElementOffset(arr, indices, count, iter)];
+	}
 
-        if (m_LineOffset >= (int)tokens.size())
-		{
-			m_LineOffset = 0;
-            m_NextLine = Result_NextLine;
+	void Interpreter::StoreElement(int slot, const Object* indices, int count, const Object& value, Token::Iter iter)
+	{
+		auto variable = m_Variables.Get(slot);
 
-            return false;
-		}
+		if (!variable || !std::holds_alternative<Array>(variable.value().get()))
+			throw Exception_Iter(iter, "Variable is not an array");
 
-        m_NextLine = Result_NextLine;
-		m_End = tokens.end();
+		Array& arr = std::get<Array>(variable.value().get());
 
-		m_Cursor = tokens.begin() + m_LineOffset;
-        m_LineOffset = 0;
+		size_t offset = ElementOffset(arr, indices, count, iter);
 
-		bool newStmt = true;
+		if (!std::holds_alternative<Numeric>(value))
+			throw Exception_Iter(iter, "Can only assign numeric values to array elements");
 
-        auto EnsureNewStatement = [&]()
+		arr.Mutable()[offset] = Numeric{ ConvertNumber(m_Variables.GetType(slot), std::get<Numeric>(value).value, iter) };
+	}
+
+	void Interpreter::Assign(int slot, const Object& value, Token::Iter iter)
+	{
+		VarType type = m_Variables.GetType(slot);
+
+		if (type == VarType::Any)
+			m_Variables.Set(slot, value);
+		else
+			m_Variables.Set(slot, ConvertValue(type, value, iter));
+	}
+
+	Object Interpreter::ConvertValue(VarType type, const Object& value, Token::Iter iter)
+	{
+		switch (type)
 		{
-			if (!newStmt)
-				throw Exception_Iter(m_Cursor, "Expected : before new statement");
-		};
+		case VarType::Any:
+			return value;
 
-		while (m_Cursor != tokens.end())
+		case VarType::String:
 		{
-            try
-            {
-                switch (m_Cursor->type)
-                {
-                case Token::Type::Keyword_Print: EnsureNewStatement(); HandlePrint(); newStmt = false; break;
-                case Token::Type::Keyword_Input: EnsureNewStatement(); HandleInput(); newStmt = false; break;
-                case Token::Type::Keyword_Cls: EnsureNewStatement(); HandleCls(); newStmt = false; break;
+			if (!std::holds_alternative<String>(value))
+				throw Exception_Iter(iter, "Type mismatch");
+
+			return value;
+		}
+
+		default:
+		{
+			if (!std::holds_alternative<Numeric>(value))
+				throw Exception_Iter(iter, "Type mismatch");
+
+			return Numeric{ ConvertNumber(type, std::get<Numeric>(value).value, iter) };
+		}
+
+		}
+	}
+
+	Real Interpreter::ConvertNumber(VarType type, Real value, Token::Iter iter)
+	{
+		switch (type)
+		{
+		case VarType::Integer:
+		{
+			// The fractional part is dropped like in MSX BASIC
+			if (!(VARINT_MIN - 1 < value && value < VARINT_MAX + 1))
+				throw Exception_Iter(iter, "Overflow");
+
+			return (Real)(Integer)value;
+		}
+
+		case VarType::Single:
+		{
+			if (std::fabs(value) > std::numeric_limits<float>::max() && std::isfinite(value))
+				throw Exception_Iter(iter, "Overflow");
+
+			return (Real)(float)value;
+		}
+
+		default: return value;
+		}
+	}
+
+	Object Interpreter::ApplyUnary(Operator::Type type, const Object& operand, Token::Iter iter)
+	{
+        Real number = UnwrapValue<Numeric>(iter, operand, "Can't apply unary operator to non-numeric value");
+
+		switch (type)
+		{
+		case Operator::Type::Subtraction: return Numeric{ -number };
+		case Operator::Type::Addition:    return Numeric{ +number };
+        default: /* Unreachable */ return Numeric{ number };
+        }
+	}
+
+    static Real ApplyNumeric(Operator::Type type, Real lhs, Real rhs)
+    {
+        switch (type)
+        {
+        case Operator::Type::Equals:         return (Real)(lhs == rhs);
+        case Operator::Type::NotEquals:      return (Real)(lhs != rhs);
+        case Operator::Type::Less:           return (Real)(lhs < rhs);
+        case Operator::Type::Greater:        return (Real)(lhs > rhs);
+        case Operator::Type::LessEquals:     return (Real)(lhs <= rhs);
+        case Operator::Type::GreaterEquals:  return (Real)(lhs >= rhs);
+        case Operator::Type::And:            return (Real)(lhs != 0 && rhs != 0);
+        case Operator::Type::Or:             return (Real)(lhs != 0 || rhs != 0);
+        case Operator::Type::Subtraction:    return lhs - rhs;
+        case Operator::Type::Addition:       return lhs + rhs;
+        case Operator::Type::Multiplication: return lhs * rhs;
+        case Operator::Type::Division:       return lhs / rhs;
+        case Operator::Type::Power:          return std::pow(lhs, rhs);
+        default: /* Unreachable */           return 0.0;
+        }
+    }
+
+    // Operands are values of the integer variables so the result can't overflow
+    static Real ApplyInteger(Operator::Type type, Integer lhs, Integer rhs)
+    {
+        switch (type)
+        {
+        case Operator::Type::Equals:         return (Real)(lhs == rhs);
+        case Operator::Type::NotEquals:      return (Real)(lhs != rhs);
+        case Operator::Type::Less:           return (Real)(lhs < rhs);
+        case Operator::Type::Greater:        return (Real)(lhs > rhs);
+        case Operator::Type::LessEquals:     return (Real)(lhs <= rhs);
+        case Operator::Type::GreaterEquals:  return (Real)(lhs >= rhs);
+        case Operator::Type::Subtraction:    return (Real)(lhs - rhs);
+        case Operator::Type::Addition:       return (Real)(lhs + rhs);
+        case Operator::Type::Multiplication: return (Real)(lhs * rhs);
+        default:                             return ApplyNumeric(type, (Real)lhs, (Real)rhs);
+        }
+    }
+
+	Object Interpreter::ApplyBinary(Operator::Type type, const Object& left, const Object& right, Token::Iter iter)
+	{
+        const Object& lhs = UnwrapValue(iter, left);
+        const Object& rhs = UnwrapValue(iter, right);
+
+        if (std::holds_alternative<Numeric>(lhs) && std::holds_alternative<Numeric>(rhs))
+            return Numeric{ ApplyNumeric(type, std::get<Numeric>(lhs).value, std::get<Numeric>(rhs).value) };
+
+        switch (type)
+        {
+        case Operator::Type::Equals:
+        case Operator::Type::NotEquals:
+        case Operator::Type::Less:
+        case Operator::Type::Greater:
+        case Operator::Type::LessEquals:
+        case Operator::Type::GreaterEquals:
+        {
+            auto Compare = [&](auto comparator) -> Object
+            {
+                if (std::holds_alternative<String>(lhs) && std::holds_alternative<String>(rhs))
+                    return Numeric{ (Real)comparator(*std::get<String>(lhs).value, *std::get<String>(rhs).value) };
+
+                throw Exception_Iter(iter, "Can't compare 2 values");
+            };
+
+            switch (type)
+            {
+            case Operator::Type::Equals:        return Compare(std::equal_to<>());
+            case Operator::Type::NotEquals:     return Compare(std::not_equal_to<>());
+            case Operator::Type::Less:          return Compare(std::less<>());
+            case Operator::Type::Greater:       return Compare(std::greater<>());
+            case Operator::Type::LessEquals:    return Compare(std::less_equal<>());
+            default:                            return Compare(std::greater_equal<>());
+            }
+        }
+
+        case Operator::Type::And:
+        {
+            auto lhsVal = UnwrapValue<Numeric>(iter, lhs, "Expected number");
+            auto rhsVal = UnwrapValue<Numeric>(iter, rhs, "Expected number");
+            return Numeric{ (Real)((lhsVal != 0) && (rhsVal != 0)) };
+        }
+
+        case Operator::Type::Or:
+        {
+            auto lhsVal = UnwrapValue<Numeric>(iter, lhs, "Expected number");
+            auto rhsVal = UnwrapValue<Numeric>(iter, rhs, "Expected number");
+            return Numeric{ (Real)((lhsVal != 0) || (rhsVal != 0)) };
+        }
+
+        default:
+        {
+            if (std::holds_alternative<String>(lhs) && std::holds_alternative<String>(rhs))
+            {
+                if (type == Operator::Type::Addition)
+                    return String{ *std::get<String>(lhs).value + *std::get<String>(rhs).value };
+
+                throw Exception_Iter(iter+1, "Can only concatenate strings");
+            }
+
+            throw Exception_Iter(iter+1, "Can't perform binary operations on values with different types");
+        }
+
+        }
+	}
+
+	Object Interpreter::ApplyFunction(Token::Type type, const Object& argument, Token::Iter iter)
+	{
+        auto ApplyFunc = [&](Real(*func)(Real), const std::string& signature, Real bottom, Real top) -> Object
+            {
+                Real value = UnwrapValue<Numeric>(iter, argument, "Argument must be numeric: " + signature + " <arg>");
+
+                if (value < bottom || value > top)
+                    throw Exception_Iter(iter, "Argument must be within the range: [" + std::to_string(bottom) + ", " + std::to_string(top) + "]");
+
+                return Numeric{ func(value) };
+            };
+
+		switch (type)
+		{
+        case Token::Type::Keyword_Sin:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::sin), "SIN", Numeric::MIN, Numeric::MAX);
+        case Token::Type::Keyword_Cos:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::cos), "COS", Numeric::MIN, Numeric::MAX);
+        case Token::Type::Keyword_Tan:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::tan), "TAN", Numeric::MIN, Numeric::MAX);
+
+        case Token::Type::Keyword_ArcSin:  return ApplyFunc(static_cast<Real(*)(Real)>(&std::asin), "ARCSIN", -1.0, 1.0);
+        case Token::Type::Keyword_ArcCos:  return ApplyFunc(static_cast<Real(*)(Real)>(&std::acos), "ARCCOS", -1.0, 1.0);
+        case Token::Type::Keyword_ArcTan:  return ApplyFunc(static_cast<Real(*)(Real)>(&std::atan), "ARCTAN", -3.145926535 * 0.5, 3.145926535 * 0.5);
+
+        case Token::Type::Keyword_Sqrt:    return ApplyFunc(static_cast<Real(*)(Real)>(&std::sqrt), "SQR", 0.0, Numeric::MAX);
+        case Token::Type::Keyword_Log:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::log10), "LOG", Numeric::EPS, Numeric::MAX);
+        case Token::Type::Keyword_Ln:      return ApplyFunc(static_cast<Real(*)(Real)>(&std::log), "LN", Numeric::EPS, Numeric::MAX);
+        case Token::Type::Keyword_Exp:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::exp), "EXP", Numeric::MIN, Numeric::MAX);
+        case Token::Type::Keyword_Abs:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::fabs), "ABS", Numeric::MIN, Numeric::MAX);
+        case Token::Type::Keyword_Sign:    return ApplyFunc(Real_Sign, "SIGN", Numeric::MIN, Numeric::MAX);
+        case Token::Type::Keyword_Int:     return ApplyFunc(static_cast<Real(*)(Real)>(&std::trunc), "INT", Numeric::MIN, Numeric::MAX);
+
+        case Token::Type::Keyword_Val:
+        {
+            const std::string& value = *UnwrapValue<String>(iter + 1, argument, "Argument must be string: VAL <arg>");
+            return Numeric{ Real_Parse(value) };
+        }
+
+        case Token::Type::Keyword_Str:
+        {
+            Real value = UnwrapValue<Numeric>(iter, argument, "Argument must be numeric: STR$ <arg>");
+
+            char text[REAL_FORMAT_SIZE];
+            return String{ std::string(text, Real_Format(value, text)) };
+        }
+
+        case Token::Type::Keyword_Random:
+            return Numeric{ (Real)rand() / (Real)RAND_MAX };
+
+        default: /* Unreachable */ return argument;
+
+		}
+	}
+
+	Object Interpreter::ApplyReduction(Token::Type type, const Object* arguments, int count, Token::Iter iter)
+	{
+		std::string name;
+
+		switch (type)
+		{
+		case Token::Type::Keyword_Sum:   name = "SUM"; break;
+		case Token::Type::Keyword_Dot:   name = "DOT"; break;
+		case Token::Type::Keyword_MinA:  name = "MINA"; break;
+		case Token::Type::Keyword_MaxA:  name = "MAXA"; break;
+		case Token::Type::Keyword_Mean:  name = "MEAN"; break;
+		default: break;
+		}
+
+		const bool dot = type == Token::Type::Keyword_Dot;
+
+		// DOT takes two arrays, the rest of the arguments is an optional range of the elements
+		const int arrays = dot ? 2 : 1;
+
+		if (count != arrays && count != arrays + 2)
+		{
+			if (dot)
+				throw Exception_Iter(iter, "Expected arguments: DOT(<array>, <array> [, <first>, <last>])");
+
+			throw Exception_Iter(iter, "Expected arguments: " + name + "(<array> [, <first>, <last>])");
+		}
+
+		auto ArrayOf = [&](const Object& argument) -> const Array&
+			{
+				const Object& value = UnwrapValue(iter, argument);
+
+				if (!std::holds_alternative<Array>(value))
+					throw Exception_Iter(iter, "Argument must be an array: " + name);
+
+				return std::get<Array>(value);
+			};
+
+		const Array& values = ArrayOf(arguments[0]);
+		const size_t size = values.value->size();
+
+		// The range goes over the elements in the row-major order and includes both ends
+		size_t first = 0;
+		size_t last = size - 1;
+
+		if (count == arrays + 2)
+		{
+			// Negative values become too big to be inside
+			first = (size_t)ToIndex(UnwrapValue<Numeric>(iter, arguments[arrays], "Range must be numeric: " + name));
+			last = (size_t)ToIndex(UnwrapValue<Numeric>(iter, arguments[arrays + 1], "Range must be numeric: " + name));
+
+			if (first >= size || last >= size || first > last)
+				throw Exception_Iter(iter, "Array index out of bounds");
+		}
+
+		const Real* data = values.Data() + first;
+		const size_t length = last - first + 1;
+
+		switch (type)
+		{
+		case Token::Type::Keyword_Sum:   return Numeric{ Kernels::Sum(data, length) };
+		case Token::Type::Keyword_MinA:  return Numeric{ Kernels::Min(data, length) };
+		case Token::Type::Keyword_MaxA:  return Numeric{ Kernels::Max(data, length) };
+		case Token::Type::Keyword_Mean:  return Numeric{ Kernels::Sum(data, length) / (Real)length };
+
+		case Token::Type::Keyword_Dot:
+		{
+			const Array& other = ArrayOf(arguments[1]);
+
+			if (other.value->size() != size)
+				throw Exception_Iter(iter, "Arrays must have the same number of elements");
+
+			return Numeric{ Kernels::Dot(data, other.Data() + first, length) };
+		}
+
+		default: /* Unreachable */ return Numeric{ 0.0 };
+
+		}
+	}
+
+    void Interpreter::Reset()
+    {
+        m_NextLine = -1;
+        m_LineOffset = 0;
+        m_LineIndex = -1;
+
+        m_Begin = Token::Iter();
+        m_Cursor = Token::Iter();
+        m_End = Token::Iter();
+
+        m_ForStack.clear();
+    }
+
+    Exception GenerateException(const LiteralPool& pool, const std::vector<Basic::Token>& tokens, const std::string& input, const Basic::Exception_Iter& exception)
+    {
+        int pos = 0;
+
+        for (auto it = tokens.begin(); it != exception.iterator; ++it)
+            pos += pool.GetText(*it).length() + 1;
+
+        return Basic::Exception(input, pos + 1, exception.message);
+    }
+
+    bool Interpreter::RunLine(std::vector<Token>& tokens, int lineNumber)
+    {
+        if (tokens.empty())
+            return false;
+
+        if (m_LineOffset == 0)
+            ResolveSymbols(tokens);
+
+        bool programmMode = lineNumber > 0;
+
+        // If the first token in a string is decimal then it must be a line number
+        // so we don't want to execute our programm, we just want to save the line
+        if (!programmMode && m_LineOffset == 0 && tokens[0].type == Token::Type::Literal_NumericBase10)
+        {
+            int line = (int)m_Pool.GetNumber(tokens[0]);
+
+            if (line < 0)
+                throw Exception_Iter(tokens.begin() + 1, "Invalid line number");
+
+            // Replacing the line also drops the expressions compiled from the old one
+            m_Programm[line] = Line(std::vector<Token>(tokens.begin() + 1, tokens.end()));
+
+            return true;
+        }
+
+        // Expressions of the previous line are not valid anymore
+        if (m_LineOffset == 0)
+            m_ImmediateCache.Reset(tokens.size());
+
+        return RunLine(tokens, lineNumber, m_ImmediateCache);
+    }
+
+    void Interpreter::ResolveSymbols(std::vector<Token>& tokens)
+    {
+        for (auto& token : tokens)
+        {
+            if (token.type == Token::Type::Symbol)
+                token.slot = m_Variables.Resolve(m_Pool.GetText(token));
+        }
+    }
+
+    bool Interpreter::RunLine(const std::vector<Token>& tokens, int lineNumber, ExpressionCache& cache)
+    {
+        bool programmMode = lineNumber > 0;
+
+        if (m_LineOffset >= (int)tokens.size())
+		{
+			m_LineOffset = 0;
+            m_NextLine = Result_NextLine;
+
+            return false;
+		}
+
+        m_NextLine = Result_NextLine;
+
+		m_Begin = tokens.begin();
+		m_End = tokens.end();
+
+		m_Cache = &cache;
+
+		m_Cursor = tokens.begin() + m_LineOffset;
+        m_LineOffset = 0;
+
+		bool newStmt = true;
+
+        auto EnsureNewStatement = [&]()
+		{
+			if (!newStmt)
+				throw Exception_Iter(m_Cursor, "Expected : before new statement");
+		};
+
+		while (m_Cursor != tokens.end())
+		{
+            try
+            {
+                switch (m_Cursor->type)
+                {
+                case Token::Type::Keyword_Print: EnsureNewStatement(); HandlePrint(); newStmt = false; break;
+                case Token::Type::Keyword_Input: EnsureNewStatement(); HandleInput(); newStmt = false; break;
+                case Token::Type::Keyword_Cls: EnsureNewStatement(); HandleCls(); newStmt = false; break;
                 case Token::Type::Keyword_Let: EnsureNewStatement(); HandleLet(); newStmt = false; break;
                 case Token::Type::Keyword_Dim: EnsureNewStatement(); HandleDim(); newStmt = false; break;
+                case Token::Type::Keyword_DefInt: EnsureNewStatement(); HandleDefType(VarType::Integer); newStmt = false; break;
+                case Token::Type::Keyword_DefSng: EnsureNewStatement(); HandleDefType(VarType::Single); newStmt = false; break;
+                case Token::Type::Keyword_DefDbl: EnsureNewStatement(); HandleDefType(VarType::Double); newStmt = false; break;
+                case Token::Type::Keyword_DefStr: EnsureNewStatement(); HandleDefType(VarType::String); newStmt = false; break;
+                case Token::Type::Keyword_Mat: EnsureNewStatement(); HandleMat(); newStmt = false; break;
+                case Token::Type::Keyword_Sort: EnsureNewStatement(); HandleSort(); newStmt = false; break;
+                case Token::Type::Keyword_Option: EnsureNewStatement(); HandleOption(); newStmt = false; break;
+                case Token::Type::Keyword_Flush: EnsureNewStatement(); HandleFlush(); newStmt = false; break;
+                case Token::Type::Keyword_Save: EnsureNewStatement(); HandleSave(); newStmt = false; break;
                 case Token::Type::Keyword_Rem: EnsureNewStatement(); m_NextLine = Result_NextLine; return programmMode;
                 case Token::Type::Keyword_Goto: EnsureNewStatement(); HandleGoto(); return programmMode;
                 case Token::Type::Keyword_If: EnsureNewStatement(); HandleIf(); newStmt = true; break;
@@ -601,7 +1047,7 @@ namespace Basic
                     ForNode& node = m_ForStack.back();
 
                     node.posInLine = (int)std::distance(tokens.begin(), m_Cursor);
-                    node.line = lineNumber;
+                    node.line = m_LineIndex;
                 }
                 break;
 
@@ -611,13 +1057,9 @@ namespace Basic
                     HandleNext();
                     newStmt = false;
 
-                    if (m_NextLine != -1)
-                    {
-                        ForNode& node = m_ForStack.back();
-                        m_LineOffset = node.posInLine + 1;
-
+                    // The loop continues in another line
+                    if (m_NextLine != Result_NextLine)
                         return programmMode;
-                    }
                 }
                 break;
 
@@ -630,7 +1072,7 @@ namespace Basic
 
                     m_SubStack.push_back(
                         SubNode{
-                            .line = lineNumber,
+                            .line = m_LineIndex,
                             .posInLine = (int)std::distance(tokens.begin(), m_Cursor)
                         });
 
@@ -639,8 +1081,10 @@ namespace Basic
 
                 case Token::Type::Keyword_Return: EnsureNewStatement(); HandleReturn(); return programmMode;
                 case Token::Type::Keyword_List: EnsureNewStatement(); HandleList(); return programmMode;
-                case Token::Type::Keyword_New: EnsureNewStatement(); HandleNew(); return programmMode;
-                case Token::Type::Keyword_Load: EnsureNewStatement(); HandleLoad(); return programmMode;
+
+                // Lines of the running programm don't exist anymore
+                case Token::Type::Keyword_New: EnsureNewStatement(); HandleNew(); m_NextLine = Result_Terminate; return programmMode;
+                case Token::Type::Keyword_Load: EnsureNewStatement(); HandleLoad(); m_NextLine = Result_Terminate; return programmMode;
 
                 case Token::Type::Keyword_Run:
                 {
@@ -659,42 +1103,24 @@ namespace Basic
 
                     if (m_Cursor->type == Token::Type::Symbol && next != tokens.end() && next->type == Token::Type::Parenthesis_Open)
                     {
-                        std::string name = m_Cursor->value;
+                        int slot = m_Cursor->slot;
                         ++m_Cursor;
 
-                        int index = ParseArrayIndex(m_Cursor);
-
-                        if (m_Cursor->type != Token::Type::Operator || m_Cursor->value != "=")
-                            throw Exception_Iter(m_Cursor, "Expected = after array index");
-
-                        try
-                        {
-                            auto [res, end] = ParseExpression(m_Cursor + 1);
-                            auto value = m_Variables.Get(name);
-
-                            if (!value || !std::holds_alternative<Array>(value.value().get()))
-                                throw Exception_Iter(m_Cursor, "Variable is not an array");
-
-                            Array& arr = std::get<Array>(value.value().get());
+                        newStmt = false;
 
-                            if (index < 0 || index >= (int)arr.value.size())
-                                throw Exception_Iter(m_Cursor, "Array index out of bounds");
+                        ParseArrayIndices(m_Cursor);
 
-                            if (!std::holds_alternative<Numeric>(res))
-                                throw Exception_Iter(m_Cursor, "Can only assign numeric values to array elements");
+                        if (m_Cursor == tokens.end() || m_Cursor->type != Token::Type::Operator || m_Cursor->op.type != Operator::Type::Assign)
+                            throw Exception_Iter(m_Cursor, "Expected = after array index");
 
-                            arr.value[index] = std::get<Numeric>(res);
+                        auto [res, end] = ParseExpression(m_Cursor + 1);
 
-                            if (m_Cursor == end)
-                                ++m_Cursor;
-                            else
-                                m_Cursor = end;
+                        StoreElement(slot, m_Indices.data(), (int)m_Indices.size(), res, m_Cursor);
 
-                        }
-                        catch (const Exception_Iter& e)
-                        {
-                            throw e;
-                        }
+                        if (m_Cursor == end)
+                            ++m_Cursor;
+                        else
+                            m_Cursor = end;
                     }
                     else if (m_Cursor->type == Token::Type::Colon)
                     {
@@ -702,19 +1128,16 @@ namespace Basic
                         ++m_Cursor;
                     }
                     else
+                    {
                         newStmt = false;
 
-                    auto [_, end] = ParseExpression(m_Cursor);
+                        auto [_, end] = ParseExpression(m_Cursor);
 
-                    if (m_Cursor == end)
-                    {
-                        m_NextLine = lineNumber;
-                        m_LineOffset = (int)std::distance(tokens.begin(), m_Cursor);
+                        if (m_Cursor == end)
+                            throw Exception_Iter(m_Cursor, "Unexpected token: " + m_Pool.GetText(*m_Cursor));
 
-                        return programmMode;
-                    }
-                    else
                         m_Cursor = end;
+                    }
                 }
                 }
             }
@@ -730,6 +1153,12 @@ namespace Basic
 	// PRINT <?expr>; <?expr>; ...
 	void Interpreter::HandlePrint()
 	{
+		if (std::next(m_Cursor) != m_End && std::next(m_Cursor)->type == Token::Type::Keyword_Using)
+		{
+			HandlePrintUsing();
+			return;
+		}
+
 		do
 		{
 			// PRINT / ;
@@ -742,19 +1171,7 @@ namespace Basic
 
                 if (m_Cursor != end)
                 {
-                    std::visit(
-                        std::overloaded
-                        {
-                            [&](const Array& arr)
-                            {
-                                throw Exception_Iter(m_Cursor, "Can't print array");
-                            },
-                            [](const auto& obj)
-                            {
-                                std::cout << obj.value;
-                            },
-                        }, res);
-
+                    PrintValue(res, m_Cursor, Expression_ResultSlot(*m_Cache->entries[std::distance(m_Begin, m_Cursor)]));
                     m_Cursor = end;
                 }
             }
@@ -766,38 +1183,186 @@ namespace Basic
 		while (m_Cursor != m_End && m_Cursor->type == Token::Type::Semicolon);
 
         if (std::prev(m_Cursor)->type != Token::Type::Semicolon)
-            std::cout << std::endl;
+            m_Output.NewLine();
 	}
 
-    // INPUT <?question>; <variable>
-    void Interpreter::HandleInput()
+	// PRINT USING <format>; <expr> [; <expr> ...]
+	void Interpreter::HandlePrintUsing()
 	{
-		// INPUT
-		++m_Cursor;
-
-        try
-        {
-            // <question>
-            if (m_Cursor != m_End && m_Cursor->type == Token::Type::Literal_String)
-            {
-                std::cout << m_Cursor->value;
-
-                // <question>
-                ++m_Cursor;
+		// PRINT USING
+		m_Cursor += 2;
 
-                if (m_Cursor == m_End || m_Cursor->type != Token::Type::Semicolon)
-                    throw Exception_Iter(m_Cursor, "Expected ;");
+		const auto source = m_Cursor;
 
-                // ;
-                ++m_Cursor;
-            }
+		UsingFormat parsed;
+		const UsingFormat* format = &parsed;
 
-            if (m_Cursor != m_End && m_Cursor->type == Token::Type::Symbol)
-            {
-                std::string line;
-                std::getline(std::cin >> std::ws, line);
+		// <format>
+		if (!IsEnd() && m_Cursor->type == Token::Type::Literal_String)
+		{
+			// Format is parsed only once per line
+			auto& entry = m_Cache->formats[std::distance(m_Begin, m_Cursor)];
 
-                m_Variables.Set(m_Cursor->value, String { line });
+			if (!entry)
+				entry = UsingFormat::Parse(*m_Pool.GetString(*m_Cursor).value);
+
+			format = &*entry;
+			++m_Cursor;
+		}
+		else
+		{
+			auto [res, end] = ParseExpression(m_Cursor);
+
+			if (m_Cursor == end || !std::holds_alternative<String>(res))
+				throw Exception_Iter(m_Cursor, "Expected format string");
+
+			parsed = UsingFormat::Parse(*std::get<String>(res).value);
+			m_Cursor = end;
+		}
+
+		std::vector<Object>& values = m_Using;
+		values.clear();
+
+		// ; <expr>
+		while (!IsEnd() && m_Cursor->type == Token::Type::Semicolon)
+		{
+			++m_Cursor;
+
+			auto [res, end] = ParseExpression(m_Cursor);
+
+			if (m_Cursor == end)
+				break;
+
+			values.push_back(res);
+			m_Cursor = end;
+		}
+
+		PrintUsing(*format, values.data(), (int)values.size(), source);
+
+		if (std::prev(m_Cursor)->type != Token::Type::Semicolon)
+			m_Output.NewLine();
+	}
+
+	void Interpreter::PrintUsing(const UsingFormat& format, const Object* values, int count, Token::Iter iter)
+	{
+		using Kind = UsingFormat::Field::Kind;
+
+		const int fields = (int)format.fields.size();
+
+		if (fields == 0)
+			throw Exception_Iter(iter, "Format must have a field");
+
+		if (count == 0)
+			throw Exception_Iter(iter, "Expected value after the format");
+
+		for (int i = 0; i < count; i++)
+		{
+			// Format starts again when all fields are used
+			if (i > 0 && i % fields == 0)
+				m_Output.Write(format.suffix);
+
+			const UsingFormat::Field& field = format.fields[i % fields];
+			const Object& value = UnwrapValue(iter, values[i]);
+
+			m_Output.Write(field.prefix);
+
+			if (field.kind == Kind::Number)
+			{
+				if (!std::holds_alternative<Numeric>(value))
+					throw Exception_Iter(iter, "Type mismatch");
+
+				m_Output.WriteUsing(field, std::get<Numeric>(value).value);
+			}
+			else
+			{
+				if (!std::holds_alternative<String>(value))
+					throw Exception_Iter(iter, "Type mismatch");
+
+				m_Output.WriteUsing(field, *std::get<String>(value).value);
+			}
+		}
+
+		// Text up to the next field
+		if (count % fields == 0)
+			m_Output.Write(format.suffix);
+		else
+			m_Output.Write(format.fields[count % fields].prefix);
+	}
+
+	void Interpreter::PrintValue(const Object& value, Token::Iter iter, int slot)
+	{
+		const bool single = slot >= 0 && m_Variables.GetType(slot) == VarType::Single;
+
+        std::visit(
+            std::overloaded
+            {
+                [&](const Array& arr)
+                {
+                    throw Exception_Iter(iter, "Can't print array");
+                },
+                [&](const String& str)
+                {
+                    m_Output.Write(*str.value);
+                },
+                [&](const auto& obj)
+                {
+                    m_Output.Write(obj.value, single);
+                },
+            }, value);
+	}
+
+    // INPUT <?question>; <variable>
+    void Interpreter::HandleInput()
+	{
+		// INPUT
+		++m_Cursor;
+
+        try
+        {
+            // <question>
+            if (m_Cursor != m_End && m_Cursor->type == Token::Type::Literal_String)
+            {
+                m_Output.Write(m_Pool.GetText(*m_Cursor));
+
+                // <question>
+                ++m_Cursor;
+
+                if (m_Cursor == m_End || m_Cursor->type != Token::Type::Semicolon)
+                    throw Exception_Iter(m_Cursor, "Expected ;");
+
+                // ;
+                ++m_Cursor;
+            }
+
+            if (m_Cursor != m_End && m_Cursor->type == Token::Type::Symbol)
+            {
+                // The question and everything before it must be seen
+                m_Output.Flush();
+
+                std::string line;
+                std::getline(std::cin >> std::ws, line);
+
+                int slot = m_Cursor->slot;
+                VarType type = m_Variables.GetType(slot);
+
+                if (type == VarType::Any || type == VarType::String)
+                    m_Variables.Set(slot, String{ line });
+                else
+                {
+                    // Typed numeric variables get the number
+                    Real number;
+
+                    try
+                    {
+                        number = Real_Parse(line);
+                    }
+                    catch (const std::exception&)
+                    {
+                        throw Exception_Iter(m_Cursor, "Expected a number");
+                    }
+
+                    m_Variables.Set(slot, Numeric{ ConvertNumber(type, number, m_Cursor) });
+                }
 
                 // <variable>
                 ++m_Cursor;
@@ -811,190 +1376,1035 @@ namespace Basic
         }
 	}
 
-	// CLS
-	void Interpreter::HandleCls()
-	{
-	#ifdef _WIN32
-		system("cls");
-	#else
-		system("clear");
-	#endif
+	// CLS
+	void Interpreter::HandleCls()
+	{
+		m_Output.Flush();
+
+	#ifdef _WIN32
+		system("cls");
+	#else
+		system("clear");
+	#endif
+
+		++m_Cursor;
+	}
+
+	// LET <name> = <expr>
+	void Interpreter::HandleLet()
+	{
+		// LET
+		++m_Cursor;
+
+		// <name>
+		if (m_Cursor->type != Token::Type::Symbol)
+            throw Exception_Iter(m_Cursor, "Expected variable name");
+
+		int slot = m_Cursor->slot;
+		++m_Cursor;
+
+        if (m_Cursor->type != Token::Type::Operator)
+            throw Exception_Iter(m_Cursor, "Expected =");
+
+        try
+        {
+            // <expr>
+            auto [res, end] = ParseExpression(m_Cursor + 1);
+
+            Assign(slot, res, m_Cursor);
+            m_Cursor = end;
+        }
+        catch (const Exception_Iter& e)
+        {
+            throw e;
+        }
+	}
+
+	void Interpreter::ParseArrayIndices(Token::Iter& iter)
+	{
+		if (iter->type != Token::Type::Parenthesis_Open)
+			throw Exception_Iter(iter, "Expected (");
+
+		++iter;
+
+		m_Indices.clear();
+
+		try
+		{
+			while (true)
+			{
+				auto [res, end] = ParseExpression(iter);
+
+				if (!std::holds_alternative<Numeric>(res))
+					throw Exception_Iter(iter, "Array index must be numeric");
+
+				m_Indices.push_back(res);
+
+				if (m_Indices.size() > std::numeric_limits<Byte>::max())
+					throw Exception_Iter(iter, "Too many array indices");
+
+				if (end != m_End && end->type == Token::Type::Comma)
+				{
+					iter = end + 1;
+					continue;
+				}
+
+				if (end == m_End || end->type != Token::Type::Parenthesis_Close)
+					throw Exception_Iter(end, "Expected )");
+
+				++end;
+				iter = end;
+
+				return;
+			}
+		}
+		catch (const Exception_Iter& e)
+		{
+			throw e;
+		}
+	}
+
+	Array Interpreter::NewArray(std::vector<int> sizes, Token::Iter iter)
+	{
+		size_t count = 1;
+
+		for (int size : sizes)
+		{
+			if ((size_t)size > std::vector<Numeric>().max_size() / count)
+				throw Exception_Iter(iter, "Out of memory");
+
+			count *= size;
+		}
+
+		try
+		{
+			return Array(std::move(sizes), std::vector<Numeric>(count, Numeric{ 0.0 }));
+		}
+		catch (const std::bad_alloc&)
+		{
+			throw Exception_Iter(iter, "Out of memory");
+		}
+	}
+
+	Array Interpreter::ParseNewArray(Token::Iter& iter)
+	{
+		ParseArrayIndices(iter);
+
+		std::vector<int> sizes;
+
+		for (const Object& index : m_Indices)
+		{
+			Real size = std::get<Numeric>(index).value;
+
+			if (size < 1.0)
+				throw Exception_Iter(iter, "Array size must be positive");
+
+			if (size > (Real)std::numeric_limits<int>::max())
+				throw Exception_Iter(iter, "Out of memory");
+
+			sizes.push_back((int)size);
+		}
+
+		return NewArray(std::move(sizes), iter);
+	}
+
+	// DIM <name>(<size> [, <size> ...]) [, <name>(<size> [, <size> ...]) , ...]
+	void Interpreter::HandleDim()
+	{
+		// DIM
+		++m_Cursor;
+
+		while (true)
+		{
+			// <name>
+			if (m_Cursor->type != Token::Type::Symbol)
+				throw Exception_Iter(m_Cursor, "Expected array name");
+
+			int slot = m_Cursor->slot;
+
+			if (m_Variables.GetType(slot) == VarType::String)
+				throw Exception_Iter(m_Cursor, "String arrays are not supported");
+
+			++m_Cursor;
+
+			// (<size> [, <size> ...])
+			if (IsEnd() || m_Cursor->type != Token::Type::Parenthesis_Open)
+				throw Exception_Iter(m_Cursor, "Expected ( after array name");
+
+			try
+			{
+				m_Variables.Set(slot, ParseNewArray(m_Cursor));
+			}
+			catch (const Exception_Iter& e)
+			{
+				throw e;
+			}
+
+			// Check for comma to continue or end
+			if (!IsEnd() && m_Cursor->type == Token::Type::Comma)
+			{
+				++m_Cursor;
+				continue;
+			}
+			else
+				break;
+		}
+	}
+
+	// DEFINT|DEFSNG|DEFDBL|DEFSTR <letter>[-<letter>] [, <letter>[-<letter>] , ...]
+	void Interpreter::HandleDefType(VarType type)
+	{
+		// DEFINT|DEFSNG|DEFDBL|DEFSTR
+		++m_Cursor;
+
+		auto ParseLetter = [&]()
+			{
+				if (IsEnd() || m_Cursor->type != Token::Type::Symbol)
+					throw Exception_Iter(m_Cursor, "Expected letter");
+
+				const std::string& name = m_Pool.GetText(*m_Cursor);
+
+				if (name.size() != 1 || name[0] < 'A' || name[0] > 'Z')
+					throw Exception_Iter(m_Cursor, "Expected letter");
+
+				++m_Cursor;
+				return name[0];
+			};
+
+		while (true)
+		{
+			// <letter>
+			char first = ParseLetter();
+			char last = first;
+
+			// -<letter>
+			if (!IsEnd() && m_Cursor->type == Token::Type::Operator && m_Cursor->op.type == Operator::Type::Subtraction)
+			{
+				++m_Cursor;
+				last = ParseLetter();
+
+				if (last < first)
+					throw Exception_Iter(std::prev(m_Cursor), "Invalid range of letters");
+			}
+
+			m_Variables.SetDefaultType(first, last, type);
+
+			// Check for comma to continue or end
+			if (!IsEnd() && m_Cursor->type == Token::Type::Comma)
+			{
+				++m_Cursor;
+				continue;
+			}
+			else
+				break;
+		}
+	}
+
+	// MAT <name> = <name> [ + | - | * <name> ]
+	// MAT <name> = (<expr>) * <name>
+	// MAT <name> = TRN(<name>)
+	// MAT <name> = ZER | CON | IDN [ (<size> [, <size> ...]) ]
+	void Interpreter::HandleMat()
+	{
+		// MAT
+		++m_Cursor;
+
+		// <name>
+		if (IsEnd() || m_Cursor->type != Token::Type::Symbol)
+			throw Exception_Iter(m_Cursor, "Expected array name");
+
+		const auto target = m_Cursor;
+		const int slot = m_Cursor->slot;
+		const VarType type = m_Variables.GetType(slot);
+
+		if (type == VarType::String)
+			throw Exception_Iter(m_Cursor, "String arrays are not supported");
+
+		++m_Cursor;
+
+		// =
+		if (IsEnd() || m_Cursor->type != Token::Type::Operator || m_Cursor->op.type != Operator::Type::Assign)
+			throw Exception_Iter(m_Cursor, "Expected =");
+
+		++m_Cursor;
+
+		if (IsEnd())
+			throw Exception_Iter(m_Cursor, "Expected expression");
+
+		// Arrays are copied in O(1) so the result can be built before the target is replaced
+		auto ParseArray = [&]()
+			{
+				if (IsEnd() || m_Cursor->type != Token::Type::Symbol)
+					throw Exception_Iter(m_Cursor, "Expected array name");
+
+				Array arr = GetArray(m_Cursor->slot, m_Cursor);
+				++m_Cursor;
+
+				return arr;
+			};
+
+		auto Expect = [&](Token::Type type, const char* error)
+			{
+				if (IsEnd() || m_Cursor->type != type)
+					throw Exception_Iter(m_Cursor, error);
+
+				++m_Cursor;
+			};
+
+		const auto source = m_Cursor;
+		Array result;
+
+		switch (m_Cursor->type)
+		{
+		case Token::Type::Keyword_Zer:
+		case Token::Type::Keyword_Con:
+		case Token::Type::Keyword_Idn:
+		{
+			Token::Type fill = m_Cursor->type;
+			++m_Cursor;
+
+			// Without sizes the array keeps its dimensions
+			if (!IsEnd() && m_Cursor->type == Token::Type::Parenthesis_Open)
+				result = ParseNewArray(m_Cursor);
+			else
+				result = NewArray(*GetArray(slot, target).sizes, source);
+
+			const std::vector<int>& sizes = *result.sizes;
+			Real* elements = result.MutableData();
+
+			if (fill == Token::Type::Keyword_Con)
+				std::fill(elements, elements + result.value->size(), (Real)1.0);
+			else if (fill == Token::Type::Keyword_Idn)
+			{
+				if (sizes.size() != 2 || sizes[0] != sizes[1])
+					throw Exception_Iter(source, "Matrix must be square");
+
+				for (int i = 0; i < sizes[0]; i++)
+					elements[i * sizes[0] + i] = 1.0;
+			}
+		}
+		break;
+
+		case Token::Type::Keyword_Trn:
+		{
+			++m_Cursor;
+
+			// (<name>)
+			Expect(Token::Type::Parenthesis_Open, "Expected (");
+			Array values = ParseArray();
+			Expect(Token::Type::Parenthesis_Close, "Expected )");
+
+			const std::vector<int>& sizes = *values.sizes;
+
+			if (sizes.size() != 2)
+				throw Exception_Iter(source, "Matrix must have 2 dimensions");
+
+			result = NewArray({ sizes[1], sizes[0] }, source);
+			Kernels::Transpose(result.MutableData(), values.Data(), sizes[0], sizes[1]);
+		}
+		break;
+
+		case Token::Type::Parenthesis_Open:
+		{
+			// (<expr>)
+			auto [res, end] = ParseExpression(m_Cursor + 1);
+
+			if (!std::holds_alternative<Numeric>(res))
+				throw Exception_Iter(m_Cursor + 1, "Expected number");
+
+			m_Cursor = end;
+			Expect(Token::Type::Parenthesis_Close, "Expected )");
+
+			// *
+			if (IsEnd() || m_Cursor->type != Token::Type::Operator || m_Cursor->op.type != Operator::Type::Multiplication)
+				throw Exception_Iter(m_Cursor, "Expected *");
+
+			++m_Cursor;
+
+			// <name>
+			Array values = ParseArray();
+
+			result = NewArray(*values.sizes, source);
+			Kernels::Scale(result.MutableData(), std::get<Numeric>(res).value, values.Data(), values.value->size());
+		}
+		break;
+
+		default:
+		{
+			// <name>
+			Array lhs = ParseArray();
+
+			if (IsEnd() || m_Cursor->type != Token::Type::Operator)
+			{
+				result = lhs;
+				break;
+			}
+
+			// + | - | *
+			const auto op = m_Cursor;
+			++m_Cursor;
+
+			// <name>
+			Array rhs = ParseArray();
+
+			const std::vector<int>& lhsSizes = *lhs.sizes;
+			const std::vector<int>& rhsSizes = *rhs.sizes;
+
+			switch (op->op.type)
+			{
+			case Operator::Type::Addition:
+			case Operator::Type::Subtraction:
+			{
+				if (lhsSizes != rhsSizes)
+					throw Exception_Iter(op, "Sizes of the arrays don't match");
+
+				result = NewArray(lhsSizes, source);
+
+				if (op->op.type == Operator::Type::Addition)
+					Kernels::Add(result.MutableData(), lhs.Data(), rhs.Data(), lhs.value->size());
+				else
+					Kernels::Subtract(result.MutableData(), lhs.Data(), rhs.Data(), lhs.value->size());
+			}
+			break;
+
+			case Operator::Type::Multiplication:
+			{
+				if (lhsSizes.size() != 2 || rhsSizes.size() != 2)
+					throw Exception_Iter(op, "Matrix must have 2 dimensions");
+
+				if (lhsSizes[1] != rhsSizes[0])
+					throw Exception_Iter(op, "Sizes of the arrays don't match");
+
+				result = NewArray({ lhsSizes[0], rhsSizes[1] }, source);
+				Kernels::Multiply(result.MutableData(), lhs.Data(), rhs.Data(), lhsSizes[0], lhsSizes[1], rhsSizes[1]);
+			}
+			break;
+
+			default: throw Exception_Iter(op, "Expected +, - or *");
+			}
+		}
+		break;
+
+		}
+
+		// Elements get the type of the array, e.g. they are truncated for A%
+		if (type == VarType::Integer || type == VarType::Single)
+		{
+			for (Numeric& element : result.Mutable())
+				element.value = ConvertNumber(type, element.value, source);
+		}
+
+		m_Variables.Set(slot, result);
+	}
+
+	// SORT <name>[()] [, <first>, <last>] [DESC]
+	void Interpreter::HandleSort()
+	{
+		// SORT
+		++m_Cursor;
+
+		// <name>
+		if (IsEnd() || m_Cursor->type != Token::Type::Symbol)
+			throw Exception_Iter(m_Cursor, "Expected array name");
+
+		const auto target = m_Cursor;
+		++m_Cursor;
+
+		// ()
+		if (!IsEnd() && m_Cursor->type == Token::Type::Parenthesis_Open)
+		{
+			++m_Cursor;
+
+			if (IsEnd() || m_Cursor->type != Token::Type::Parenthesis_Close)
+				throw Exception_Iter(m_Cursor, "Expected )");
+
+			++m_Cursor;
+		}
+
+		auto ParseIndex = [&]()
+			{
+				// ,
+				if (IsEnd() || m_Cursor->type != Token::Type::Comma)
+					throw Exception_Iter(m_Cursor, "Expected ,");
+
+				++m_Cursor;
+
+				auto [res, end] = ParseExpression(m_Cursor);
+
+				if (!std::holds_alternative<Numeric>(res))
+					throw Exception_Iter(m_Cursor, "Expected number");
+
+				m_Cursor = end;
+
+				// Negative values become too big to be inside
+				return (size_t)ToIndex(std::get<Numeric>(res).value);
+			};
+
+		// The range goes over the elements in the row-major order and includes both ends
+		size_t first = 0;
+		size_t last = 0;
+
+		const bool ranged = !IsEnd() && m_Cursor->type == Token::Type::Comma;
+
+		if (ranged)
+		{
+			first = ParseIndex();
+			last = ParseIndex();
+		}
+
+		// DESC
+		bool descending = false;
+
+		if (!IsEnd() && m_Cursor->type == Token::Type::Keyword_Desc)
+		{
+			descending = true;
+			++m_Cursor;
+		}
+
+		GetArray(target->slot, target);
+		Array& arr = std::get<Array>(m_Variables.Get(target->slot).value().get());
+
+		const size_t size = arr.value->size();
+
+		if (!ranged)
+			last = size - 1;
+		else if (first >= size || last >= size || first > last)
+			throw Exception_Iter(target, "Array index out of bounds");
+
+		Kernels::Sort(arr.MutableData() + first, last - first + 1, descending);
+	}
+
+	// OPTION SHORTCIRCUIT | EAGER
+	void Interpreter::HandleOption()
+	{
+		// OPTION
+		++m_Cursor;
+
+		// Names of the options aren't keywords so they can still be used as variables
+		const std::string name = IsEnd() || m_Cursor->type != Token::Type::Symbol ? "" : m_Pool.GetText(*m_Cursor);
+
+		if (name == "SHORTCIRCUIT")
+			m_ShortCircuit = true;
+		else if (name == "EAGER")
+			m_ShortCircuit = false;
+		else
+			throw Exception_Iter(m_Cursor, "Expected SHORTCIRCUIT or EAGER");
+
+		++m_Cursor;
+	}
+
+	// FLUSH
+	void Interpreter::HandleFlush()
+	{
+		// FLUSH
+		++m_Cursor;
+
+		m_Output.Flush();
+	}
+
+    // RETURN
+    void Interpreter::HandleReturn()
+    {
+        // RETURN
+        ++m_Cursor;
+
+        if (m_SubStack.empty())
+            throw Exception_Iter(m_Cursor, "RETURN without GOSUB");
+
+        SubNode& node = m_SubStack.back();
+
+        m_NextLine = node.line;
+        m_LineOffset = node.posInLine;
+
+        m_SubStack.pop_back();
+    }
+
+    // LIST
+    void Interpreter::HandleList()
+    {
+        // LIST
+        ++m_Cursor;
+
+        for (const auto& [number, line] : m_Programm)
+        {
+            m_Output.Write(std::to_string(number));
+            m_Output.Write(TokensToString(line.tokens, m_Pool));
+            m_Output.NewLine();
+        }
+    }
+
+    // NEW
+    void Interpreter::HandleNew()
+    {
+        // NEW
+        ++m_Cursor;
+
+        m_Programm.clear();
+        m_Variables.Clear();
+
+        m_ShortCircuit = false;
+    }
+
+    // RUN [ FAST ]
+    void Interpreter::HandleRun()
+    {
+        // RUN
+        ++m_Cursor;
+
+        // FAST
+        if (m_Cursor != m_End && m_Cursor->type == Token::Type::Keyword_Fast)
+        {
+            Reset();
+
+            Compiler compiler(m_Pool);
+            Execute(compiler.Compile(m_Programm));
+
+            m_Output.Flush();
+
+            throw 0;
+        }
+
+        Reset();
+        BuildImage();
+
+        const int count = (int)m_Image.lines.size();
+
+        m_LineIndex = 0;
+
+        while (m_LineIndex < count)
+        {
+            Line& line = *m_Image.lines[m_LineIndex];
+
+            try
+            {
+                RunLine(line.tokens, m_Image.numbers[m_LineIndex], line.cache);
+
+                if (m_NextLine == Result_Terminate)
+                    break;
+                else if (m_NextLine == Result_NextLine)
+                    m_LineIndex++;
+                else
+                    m_LineIndex = m_NextLine;
+            }
+            catch (const Exception_Iter& e)
+            {
+                m_LineIndex = -1;
+                throw GenerateException(m_Pool, line.tokens, TokensToString(line.tokens, m_Pool), e);
+            }
+        }
+
+        m_LineIndex = -1;
+
+        m_Output.Flush();
+
+        throw 0;
+    }
+
+    void Interpreter::BuildImage()
+    {
+        m_Image.lines.clear();
+        m_Image.numbers.clear();
+
+        for (auto& [number, line] : m_Programm)
+        {
+            m_Image.lines.push_back(&line);
+            m_Image.numbers.push_back(number);
+        }
+
+        for (Line* line : m_Image.lines)
+        {
+            const auto& tokens = line->tokens;
+
+            line->jumps.clear();
+
+            for (size_t i = 0; i + 1 < tokens.size(); i++)
+            {
+                if (tokens[i].type != Token::Type::Keyword_Goto && tokens[i].type != Token::Type::Keyword_GoSub)
+                    continue;
+
+                // Only a single constant can be resolved before the programm runs
+                const Token& target = tokens[i + 1];
+
+                bool single = i + 2 == tokens.size() ||
+                    tokens[i + 2].type == Token::Type::Colon ||
+                    tokens[i + 2].type == Token::Type::Keyword_Else;
+
+                if (target.IsNumeric() && single)
+                    line->jumps.emplace_back((int)i + 1, m_Image.Find((int)m_Pool.GetNumber(target)));
+            }
+        }
+    }
+
+    int Interpreter::ParseJumpTarget()
+    {
+        // Jumps of the running programm are usually resolved already
+        if (m_LineIndex >= 0)
+        {
+            int offset = (int)std::distance(m_Begin, m_Cursor);
+
+            for (const auto& [position, index] : m_Image.lines[m_LineIndex]->jumps)
+            {
+                if (position == offset)
+                {
+                    ++m_Cursor;
+                    return index;
+                }
+            }
+        }
+
+        // <line>
+        auto [res, end] = ParseExpression(m_Cursor);
+
+        if (!std::holds_alternative<Numeric>(res))
+        {
+            if (end != m_End && end != m_Cursor)
+                throw Exception_Iter(std::prev(end), "Expected line number to be numeric");
+            else
+                throw Exception_Iter(m_Cursor, "Expected line number to be numeric");
+        }
+
+        m_Cursor = end;
+
+        return m_Image.Find((int)std::get<Numeric>(res).value);
+    }
+
+    void Interpreter::Execute(const Bytecode& bytecode)
+    {
+        struct Loop
+        {
+            int slot;
+            int resume;
+
+            LoopCounter counter;
+        };
+
+        std::vector<Object> stack;
+        std::vector<Loop> loops;
+        std::vector<int> calls;
+
+        int pc = 0;
+
+        // Token that produced the current instruction
+        auto Source = [&]()
+        {
+            const SourceLocation& source = bytecode.sources[pc];
+            return source.line->tokens.cbegin() + source.offset;
+        };
+
+        auto Pop = [&]()
+        {
+            Object value = std::move(stack.back());
+            stack.pop_back();
+            return value;
+        };
+
+        auto PopNumber = [&](const std::string& error)
+        {
+            Real value = UnwrapValue<Numeric>(Source(), stack.back(), error);
+            stack.pop_back();
+            return value;
+        };
+
+        try
+        {
+            while (pc < (int)bytecode.code.size())
+            {
+                const Instruction& instruction = bytecode.code[pc];
+
+                switch (instruction.code)
+                {
+                case OpCode::PushConstant:
+                    stack.push_back(bytecode.constants[instruction.operand]);
+                break;
+
+                case OpCode::Load:
+                {
+                    auto value = m_Variables.Get(instruction.operand);
+
+                    if (!value)
+                        throw Exception_Iter(Source(), "No such variable \"" + m_Variables.GetName(instruction.operand) + "\"");
+
+                    stack.push_back(*value);
+                }
+                break;
+
+                case OpCode::Store:
+                    Assign(instruction.operand, stack.back(), Source());
+                    stack.pop_back();
+                break;
+
+                case OpCode::LoadElement:
+                {
+                    const int count = instruction.arguments;
+                    Object element = LoadElement(instruction.operand, &stack[stack.size() - count], count, Source());
+
+                    stack.resize(stack.size() - count);
+                    stack.push_back(std::move(element));
+                }
+                break;
+
+                case OpCode::StoreElement:
+                {
+                    const int count = instruction.arguments;
+                    Object value = Pop();
+
+                    StoreElement(instruction.operand, &stack[stack.size() - count], count, value, Source());
+                    stack.resize(stack.size() - count);
+                }
+                break;
+
+                case OpCode::Duplicate: stack.push_back(stack.back()); break;
+                case OpCode::Pop: stack.pop_back(); break;
+
+                case OpCode::Unary:
+                    stack.back() = ApplyUnary((Operator::Type)instruction.operand, stack.back(), Source());
+                break;
+
+                case OpCode::Binary:
+                {
+                    Object rhs = Pop();
+                    stack.back() = ApplyBinary((Operator::Type)instruction.operand, stack.back(), rhs, Source());
+                }
+                break;
+
+                case OpCode::BinaryNumeric:
+                case OpCode::BinaryInteger:
+                {
+                    auto type = (Operator::Type)instruction.operand;
+
+                    Object& lhs = stack[stack.size() - 2];
+                    const Object& rhs = stack.back();
+
+                    Numeric* lhsNumber = std::get_if<Numeric>(&lhs);
+                    const Numeric* rhsNumber = std::get_if<Numeric>(&rhs);
+
+                    // Typed variable is not a number only if it was used as an array
+                    if (!lhsNumber || !rhsNumber)
+                        lhs = ApplyBinary(type, lhs, rhs, Source());
+                    else if (instruction.code == OpCode::BinaryInteger)
+                        lhsNumber->value = ApplyInteger(type, (Integer)lhsNumber->value, (Integer)rhsNumber->value);
+                    else
+                        lhsNumber->value = ApplyNumeric(type, lhsNumber->value, rhsNumber->value);
+
+                    stack.pop_back();
+                }
+                break;
+
+                case OpCode::Call:
+                {
+                    auto type = (Token::Type)instruction.operand;
+
+                    if (type == Token::Type::Keyword_Random)
+                        stack.push_back(ApplyFunction(type, Object(), Source()));
+                    else
+                        stack.back() = ApplyFunction(type, stack.back(), Source());
+                }
+                break;
+
+                case OpCode::Reduce:
+                {
+                    const int count = instruction.arguments;
+                    Object result = ApplyReduction((Token::Type)instruction.operand, &stack[stack.size() - count], count, Source());
+
+                    stack.resize(stack.size() - count);
+                    stack.push_back(std::move(result));
+                }
+                break;
+
+                case OpCode::Print:
+                    PrintValue(stack.back(), Source(), instruction.operand);
+                    stack.pop_back();
+                break;
+
+                case OpCode::PrintUsing:
+                {
+                    const int count = instruction.arguments;
+
+                    PrintUsing(bytecode.formats[instruction.operand], &stack[stack.size() - count], count, Source());
+                    stack.resize(stack.size() - count);
+                }
+                break;
+
+                case OpCode::PrintNewLine:
+                    m_Output.NewLine();
+                break;
 
-		++m_Cursor;
-	}
+                case OpCode::Jump:
+                    pc = instruction.operand;
+                continue;
 
-	// LET <name> = <expr>
-	void Interpreter::HandleLet()
-	{
-		// LET
-		++m_Cursor;
+                case OpCode::ShortCircuit:
+                {
+                    if (!m_ShortCircuit)
+                        break;
 
-		// <name>
-		if (m_Cursor->type != Token::Type::Symbol)
-            throw Exception_Iter(m_Cursor, "Expected variable name");
+                    const Object& lhs = UnwrapValue(Source(), stack.back());
 
-		std::string name = m_Cursor->value;
-		++m_Cursor;
+                    if (!std::holds_alternative<Numeric>(lhs))
+                        break;
 
-        if (m_Cursor->type != Token::Type::Operator)
-            throw Exception_Iter(m_Cursor, "Expected =");
+                    const bool value = std::get<Numeric>(lhs).value != 0.0;
 
-        try
-        {
-            // <expr>
-            auto [res, end] = ParseExpression(m_Cursor + 1);
+                    if (value == ((Operator::Type)instruction.arguments == Operator::Type::Or))
+                    {
+                        stack.back() = Numeric{ value ? 1.0 : 0.0 };
+                        pc = instruction.operand;
+                        continue;
+                    }
+                }
+                break;
 
-            m_Variables.Set(name, res);
-            m_Cursor = end;
-        }
-        catch (const Exception_Iter& e)
-        {
-            throw e;
-        }
-	}
+                case OpCode::JumpIfFalse:
+                {
+                    if (PopNumber("Expected expression result to be numeric") == 0.0)
+                    {
+                        pc = instruction.operand;
+                        continue;
+                    }
+                }
+                break;
 
-	int Interpreter::ParseArrayIndex(Token::Iter& iter)
-	{
-		if (iter->type != Token::Type::Parenthesis_Open)
-			throw Exception_Iter(iter, "Expected (");
+                case OpCode::GoSub:
+                    calls.push_back(pc + 1);
+                    pc = instruction.operand;
+                continue;
 
-		++iter;
+                case OpCode::JumpLine:
+                case OpCode::GoSubLine:
+                {
+                    auto line = bytecode.lines.find((int)PopNumber("Expected line number to be numeric"));
 
-		try
-		{
-			auto [res, end] = ParseExpression(iter);
+                    // Jump to the line that doesn't exist stops the programm
+                    if (line == bytecode.lines.end())
+                        return;
 
-			if (!std::holds_alternative<Numeric>(res))
-				throw Exception_Iter(iter, "Array index must be numeric");
+                    if (instruction.code == OpCode::GoSubLine)
+                        calls.push_back(pc + 1);
 
-			int index = (int)std::get<Numeric>(res).value;
+                    pc = line->second;
+                }
+                continue;
 
-			if (end == m_End || end->type != Token::Type::Parenthesis_Close)
-				throw Exception_Iter(end, "Expected )");
+                case OpCode::Return:
+                {
+                    if (calls.empty())
+                        throw Exception_Iter(Source(), "RETURN without GOSUB");
 
-			++end;
-			iter = end;
+                    pc = calls.back();
+                    calls.pop_back();
+                }
+                continue;
 
-			return index;
-		}
-		catch (const Exception_Iter& e)
-		{
-			throw e;
-		}
-	}
+                case OpCode::For:
+                {
+                    Real step = PopNumber("Step value must be numeric");
+                    Real endValue = PopNumber("End value must be numeric");
 
-	// DIM <name>(<size>) [, <name>(<size>) , ...]
-	void Interpreter::HandleDim()
-	{
-		// DIM
-		++m_Cursor;
+                    if (!std::holds_alternative<Numeric>(stack.back()))
+                        throw Exception_Iter(Source(), "Start value must be numeric");
 
-		while (true)
-		{
-			// <name>
-			if (m_Cursor->type != Token::Type::Symbol)
-				throw Exception_Iter(m_Cursor, "Expected array name");
+                    VarType type = m_Variables.GetType(instruction.operand);
 
-			std::string arrayName = m_Cursor->value;
-			++m_Cursor;
+                    if (type == VarType::String)
+                        throw Exception_Iter(Source(), "Type mismatch");
 
-			// (<size>)
-			if (m_Cursor->type != Token::Type::Parenthesis_Open)
-				throw Exception_Iter(m_Cursor, "Expected ( after array name");
+                    Real startValue = ConvertNumber(type, std::get<Numeric>(stack.back()).value, Source());
 
-			try
-			{
-				int size = ParseArrayIndex(m_Cursor);
+                    m_Variables.Set(instruction.operand, Numeric{ startValue });
+                    stack.pop_back();
 
-				if (size <= 0)
-					throw Exception_Iter(m_Cursor, "Array size must be positive");
+                    loops.push_back(Loop{ instruction.operand, pc + 1, LoopCounter(startValue, endValue, step) });
+                }
+                break;
 
-                Array arr{ std::vector<Numeric>(size, Numeric{ 0.0 }) };
-				m_Variables.Set(arrayName, arr);
-			}
-			catch (const Exception_Iter& e)
-			{
-				throw e;
-			}
+                case OpCode::Next:
+                {
+                    if (loops.empty())
+                        throw Exception_Iter(Source(), "NEXT without FOR");
 
-			// Check for comma to continue or end
-			if (!IsEnd() && m_Cursor->type == Token::Type::Comma)
-			{
-				++m_Cursor;
-				continue;
-			}
-			else
-				break;
-		}
-	}
+                    Loop& loop = loops.back();
 
-    // RETURN
-    void Interpreter::HandleReturn()
-    {
-        // RETURN
-        ++m_Cursor;
+                    if (instruction.operand != -1 && instruction.operand != loop.slot)
+                        throw Exception_Iter(Source() + 1, "Variable name mismatch");
 
-        if (m_SubStack.empty())
-            throw Exception_Iter(m_Cursor, "RETURN without GOSUB");
+                    auto value = m_Variables.Get(loop.slot);
 
-        SubNode& node = m_SubStack.back();
+                    if (!value || !std::holds_alternative<Numeric>(value.value().get()))
+                        throw Exception_Iter(Source(), "For loop variable is not numeric");
 
-        m_NextLine = node.line;
-        m_LineOffset = node.posInLine;
+                    Real& variable = std::get<Numeric>(value.value().get()).value;
+                    bool continues = loop.counter.Step(variable);
 
-        m_SubStack.pop_back();
-    }
+                    variable = ConvertNumber(m_Variables.GetType(loop.slot), variable, Source());
 
-    // LIST
-    void Interpreter::HandleList()
-    {
-        // LIST
-        ++m_Cursor;
+                    if (!continues)
+                    {
+                        // Loop is finished
+                        loops.pop_back();
+                    }
+                    else
+                    {
+                        // Continue loop
+                        pc = loop.resume;
+                        continue;
+                    }
+                }
+                break;
 
-        for (const auto& [line, tokens] : m_Programm)
-            std::cout << line << TokensToString(tokens) << std::endl;
-    }
+                case OpCode::Statement:
+                {
+                    Line& line = *bytecode.sources[pc].line;
 
-    // NEW
-    void Interpreter::HandleNew()
-    {
-        // NEW
-        ++m_Cursor;
+                    m_Begin = line.tokens.cbegin();
+                    m_End = line.tokens.cend();
+                    m_Cache = &line.cache;
 
-        m_Programm.clear();
-        m_Variables.Clear();
-    }
+                    m_Cursor = Source();
 
-    // RUN
-    void Interpreter::HandleRun()
-    {
-        // RUN
-        ++m_Cursor;
+                    switch (m_Cursor->type)
+                    {
+                    case Token::Type::Keyword_Print: HandlePrint(); break;
+                    case Token::Type::Keyword_Input: HandleInput(); break;
+                    case Token::Type::Keyword_Cls: HandleCls(); break;
+                    case Token::Type::Keyword_Sleep: HandleSleep(); break;
+                    case Token::Type::Keyword_Dim: HandleDim(); break;
+                    case Token::Type::Keyword_DefInt: HandleDefType(VarType::Integer); break;
+                    case Token::Type::Keyword_DefSng: HandleDefType(VarType::Single); break;
+                    case Token::Type::Keyword_DefDbl: HandleDefType(VarType::Double); break;
+                    case Token::Type::Keyword_DefStr: HandleDefType(VarType::String); break;
+                    case Token::Type::Keyword_Mat: HandleMat(); break;
+                    case Token::Type::Keyword_Sort: HandleSort(); break;
+                    case Token::Type::Keyword_Option: HandleOption(); break;
+                    case Token::Type::Keyword_Flush: HandleFlush(); break;
+                    case Token::Type::Keyword_List: HandleList(); break;
+                    case Token::Type::Keyword_Save: HandleSave(); break;
+
+                    // These replace the programm so it can't be continued
+                    case Token::Type::Keyword_Run: HandleRun(); return;
+                    case Token::Type::Keyword_New: HandleNew(); return;
+                    case Token::Type::Keyword_Load: HandleLoad(); return;
 
-        Reset();
+                    default: /* Unreachable */ break;
+                    }
 
-        auto line = m_Programm.begin();
+                    if (m_Cursor != m_Begin + instruction.operand)
+                        throw Exception_Iter(m_Cursor, "Expected : before new statement");
+                }
+                break;
 
-        while (line != m_Programm.end())
-        {
-            try
-            {
-                RunLine(line->second, line->first);
+                case OpCode::End:
+                return;
 
-                if (m_NextLine == Result_Terminate)
-                    line = m_Programm.end();
-                else if (m_NextLine == Result_NextLine)
-                    line++;
-                else
-                    line = m_Programm.find(m_NextLine);
-            }
-            catch (const Exception_Iter& e)
-            {
-                throw GenerateException(line->second, TokensToString(line->second), e);
+                }
+
+                pc++;
             }
         }
-
-        throw 0;
+        catch (const Exception_Iter& e)
+        {
+            const Line& line = *bytecode.sources[pc].line;
+            throw GenerateException(m_Pool, line.tokens, TokensToString(line.tokens, m_Pool), e);
+        }
     }
 
     // LOAD
@@ -1007,11 +2417,39 @@ namespace Basic
         if (m_Cursor->type != Token::Type::Literal_String)
             throw Exception_Iter(m_Cursor, "Expected file path");
 
-        std::ifstream ifs(m_Cursor->value);
+        std::ifstream ifs(m_Pool.GetText(*m_Cursor), std::ios::binary);
 
         if (!ifs.is_open())
             throw Exception_Iter(m_Cursor, "Can't open file");
 
+        // The whole file is read with one call and lines are tokenised in place
+        ifs.seekg(0, std::ios::end);
+        const std::streamoff size = ifs.tellg();
+        ifs.seekg(0);
+
+        // Directories are opened but can't be read, their size is -1 or made up
+        if (size < 0 || (size > 0 && ifs.peek() == std::ifstream::traits_type::eof()))
+            throw Exception_Iter(m_Cursor, "Can't open file");
+
+        std::string source((size_t)size, '\0');
+
+        if (!ifs.read(source.data(), source.size()))
+            throw Exception_Iter(m_Cursor, "Can't open file");
+
+        ifs.close();
+
+        // Programm saved by SAVE "<path>",B doesn't have to be parsed
+        if (Tokenised::IsTokenised(source))
+        {
+            if (!LoadTokenised(source))
+                throw Exception_Iter(m_Cursor, "Programm file is damaged or was saved by another version");
+
+            // <path>
+            ++m_Cursor;
+
+            return;
+        }
+
         m_Programm.clear();
 
         // Save state
@@ -1019,72 +2457,128 @@ namespace Basic
         int nextLine = m_NextLine;
         int lineOffset = m_LineOffset;
 
+        Token::Iter begin = m_Begin;
         Token::Iter cursor = m_Cursor;
         Token::Iter end = m_End;
 
+        ExpressionCache* cache = m_Cache;
+
         auto forStack = m_ForStack;
-        bool skipElse = m_SkipElse;
 
-        Parser parser;
+        Parser parser(m_Pool);
 
-        while (!ifs.eof())
+        std::string_view rest = source;
+        std::vector<Token> tokens;
+
+        while (!rest.empty())
         {
-            std::string buf;
-            std::getline(ifs, buf);
+            size_t lineEnd = rest.find('\n');
+            std::string_view buf = rest.substr(0, lineEnd);
+
+            rest = lineEnd == std::string_view::npos ? std::string_view() : rest.substr(lineEnd + 1);
 
-            std::vector<Token> tokens;
+            if (!buf.empty() && buf.back() == '\r')
+                buf.remove_suffix(1);
+
+            tokens.clear();
             parser.Tokenise(buf, tokens);
 
             RunLine(tokens);
         }
 
-        ifs.close();
-
         // Restore state
 
         m_NextLine = nextLine;
         m_LineOffset = lineOffset;
 
         // <path>
+        m_Begin = begin;
         m_Cursor = cursor + 1;
         m_End = end;
 
+        m_Cache = cache;
+
         m_ForStack = forStack;
+    }
+
+    bool Interpreter::LoadTokenised(std::string_view data)
+    {
+        m_Programm.clear();
+
+        if (!Tokenised::Read(data, m_Programm, m_Pool))
+        {
+            m_Programm.clear();
+            return false;
+        }
 
-        m_SkipElse = skipElse;
+        for (auto& [number, line] : m_Programm)
+            ResolveSymbols(line.tokens);
+
+        return true;
     }
 
-	// GOTO <line>
-	void Interpreter::HandleGoto()
-	{
-		// GOTO
-		++m_Cursor;
+    // SAVE <path> <?,B>
+    void Interpreter::HandleSave()
+    {
+        // SAVE
+        ++m_Cursor;
 
-        try
+        // <path>
+        if (IsEnd() || m_Cursor->type != Token::Type::Literal_String)
+            throw Exception_Iter(m_Cursor, "Expected file path");
+
+        Token::Iter path = m_Cursor++;
+
+        // ,B saves the tokens instead of the text
+        bool binary = false;
+
+        if (!IsEnd() && m_Cursor->type == Token::Type::Comma)
         {
-            // <line>
-            auto [res, end] = ParseExpression(m_Cursor);
+            ++m_Cursor;
 
-            if (!std::holds_alternative<Numeric>(res))
-            {
-                if (end != m_End && end != m_Cursor)
-                    throw Exception_Iter(std::prev(end), "Expected line number to be numeric");
-                else
-                    throw Exception_Iter(m_Cursor, "Expected line number to be numeric");
-            }
+            if (IsEnd() || m_Cursor->type != Token::Type::Symbol || (m_Pool.GetText(*m_Cursor) != "B" && m_Pool.GetText(*m_Cursor) != "b"))
+                throw Exception_Iter(m_Cursor, "Expected B");
 
-            m_NextLine = (int)std::get<Numeric>(res).value;
-            m_Cursor = end;
+            ++m_Cursor;
+            binary = true;
         }
-        catch (const Exception_Iter& e)
+
+        std::ofstream ofs(m_Pool.GetText(*path), binary ? std::ios::binary : std::ios::out);
+
+        if (!ofs.is_open())
+            throw Exception_Iter(path, "Can't open file");
+
+        if (binary)
         {
-            throw e;
+            std::string data = Tokenised::Write(m_Programm, m_Pool);
+            ofs.write(data.data(), data.size());
+        }
+        else
+        {
+            // Same text as LIST shows, so LOAD reads it back
+            for (const auto& [number, line] : m_Programm)
+                ofs << number << TokensToString(line.tokens, m_Pool) << '\n';
         }
+
+        if (!ofs)
+            throw Exception_Iter(path, "Can't write file");
+    }
+
+	// GOTO <line>
+	void Interpreter::HandleGoto()
+	{
+		// GOTO
+		++m_Cursor;
+
+        // <line>
+        m_NextLine = ParseJumpTarget();
 	}
 
 	// IF <expr> THEN <stmt> ELSE <stmt>
 	void Interpreter::HandleIf()
 	{
+		int& elseTarget = m_Cache->elseTargets[std::distance(m_Begin, m_Cursor)];
+
 		// IF
 		++m_Cursor;
 
@@ -1110,38 +2604,39 @@ namespace Basic
             // if <expr>=0 then move to else block if it exists
             if (std::get<Numeric>(res).value == 0.0)
             {
-                int elseBalancer = 0;
-
-                // We need to find ELSE block and execute it
-                m_SkipElse = false;
-
-                // Searching for the corresponding ELSE block
-                while (iter != m_End)
+                if (elseTarget < 0)
                 {
-                    if (iter->type == Token::Type::Keyword_If)
-                        ++elseBalancer;
+                    int elseBalancer = 0;
 
-                    if (iter->type == Token::Type::Keyword_Else)
+                    // Searching for the corresponding ELSE block only once
+                    while (iter != m_End)
                     {
-                        if (elseBalancer == 0)
+                        if (iter->type == Token::Type::Keyword_If)
+                            ++elseBalancer;
+
+                        if (iter->type == Token::Type::Keyword_Else)
                         {
-                            // Found corresponding ELSE block so just stop here
-                            m_Cursor = iter + 1;
-                            return;
+                            if (elseBalancer == 0)
+                            {
+                                // Found corresponding ELSE block so it starts after it
+                                ++iter;
+                                break;
+                            }
+
+                            --elseBalancer;
                         }
 
-                        --elseBalancer;
+                        ++iter;
                     }
 
-                    ++iter;
+                    // If there is no ELSE block then it's the end of the line
+                    elseTarget = (int)std::distance(m_Begin, iter);
                 }
 
-                // No ELSE block
+                m_Cursor = m_Begin + elseTarget;
             }
             else // <expr> != 0
-                m_SkipElse = true;
-
-            m_Cursor = iter;
+                m_Cursor = iter;
         }
         catch (const Exception_Iter& e)
         {
@@ -1151,18 +2646,9 @@ namespace Basic
 
 	void Interpreter::HandleElse()
 	{
-		if (m_SkipElse)
-		{
-			// We need to skip the corresponding ELSE block so just move to the end of the line
-			m_Cursor = m_End;
-		}
-		else
-		{
-			m_SkipElse = true;
-
-			// ELSE
-			++m_Cursor;
-		}
+		// ELSE is reached only after the THEN block of its IF was executed
+		// and the ELSE block lasts until the end of the line, so skip it
+		m_Cursor = m_End;
 	}
 
 	// FOR <var> = <expr> TO <expr> [ STEP <expr> ]
@@ -1175,11 +2661,11 @@ namespace Basic
 		if (m_Cursor->type != Token::Type::Symbol)
             throw Exception_Iter(m_Cursor, "Expected variable name");
 
-		std::string varName = m_Cursor->value;
+		int slot = m_Cursor->slot;
 		++m_Cursor;
 
 		// =
-		if (m_Cursor->type != Token::Type::Operator || m_Cursor->value != "=")
+		if (m_Cursor->type != Token::Type::Operator || m_Cursor->op.type != Operator::Type::Assign)
             throw Exception_Iter(m_Cursor, "Expected =");
 
 		++m_Cursor;
@@ -1192,6 +2678,9 @@ namespace Basic
 			if (!std::holds_alternative<Numeric>(startRes))
                 throw Exception_Iter(m_Cursor, "Start value must be numeric");
 
+			// Start value gets the type of the variable
+			startRes = ConvertValue(m_Variables.GetType(slot), startRes, m_Cursor);
+
 			// TO
 			if (startEnd->type != Token::Type::Keyword_To)
                 throw Exception_Iter(startEnd, "Expected TO");
@@ -1225,16 +2714,14 @@ namespace Basic
 
 			// Create and push a new for node
 			m_ForStack.push_back(ForNode {
-				.varName = varName,
+				.slot = slot,
 				.line = -1,
 				.posInLine = -1,
-				.startValue = std::get<Numeric>(startRes).value,
-				.endValue = std::get<Numeric>(endRes).value,
-				.step = step
+				.counter = LoopCounter(std::get<Numeric>(startRes).value, std::get<Numeric>(endRes).value, step)
 			});
 
 			// Set the variable to start value
-			m_Variables.Set(varName, startRes);
+			m_Variables.Set(slot, startRes);
 		}
         catch (const Exception_Iter& e)
         {
@@ -1256,36 +2743,42 @@ namespace Basic
 		// <?var>
 		if (m_Cursor != m_End && m_Cursor->type == Token::Type::Symbol)
 		{
-			if (m_Cursor->value != node.varName)
+			if (m_Cursor->slot != node.slot)
                 throw Exception_Iter(m_Cursor, "Variable name mismatch");
 
 			++m_Cursor;
 		}
 
 		// Increment the variable
-		auto value = m_Variables.Get(node.varName);
+		auto value = m_Variables.Get(node.slot);
 
 		if (value)
 		{
 			Object& obj = value.value().get();
 			if (std::holds_alternative<Numeric>(obj))
 			{
-				Real curValue = std::get<Numeric>(obj).value;
-				curValue += node.step;
+				Real& variable = std::get<Numeric>(obj).value;
+				bool continues = node.counter.Step(variable);
 
-				m_Variables.Set(node.varName, Numeric{ curValue });
+				variable = ConvertNumber(m_Variables.GetType(node.slot), variable, std::prev(m_Cursor));
 
-				if ((node.step > 0 && curValue > node.endValue) ||
-				    (node.step < 0 && curValue < node.endValue))
+				if (!continues)
 				{
 					// Loop is finished
 					m_ForStack.pop_back();
-                    m_NextLine = -1;
+                    m_NextLine = Result_NextLine;
+				}
+				else if (node.line == m_LineIndex)
+				{
+					// The loop is in this line so just move the cursor back
+					m_NextLine = Result_NextLine;
+					m_Cursor = m_Begin + node.posInLine;
 				}
 				else
 				{
-					// Continue loop
+					// Continue loop from the line of FOR
 					m_NextLine = node.line;
+					m_LineOffset = node.posInLine + 1;
 				}
 			}
 			else
@@ -1309,6 +2802,9 @@ namespace Basic
             if (!std::holds_alternative<Numeric>(res))
                 throw Exception_Iter(m_Cursor, "Sleep time must be numeric");
 
+            // What was printed before the pause should be seen during it
+            m_Output.Flush();
+
             std::this_thread::sleep_for(std::chrono::milliseconds((long long)std::get<Numeric>(res).value));
 
             m_Cursor = end;
@@ -1325,25 +2821,7 @@ namespace Basic
 		// GOSUB
 		++m_Cursor;
 
-        try
-        {
-            // <line>
-            auto [res, end] = ParseExpression(m_Cursor);
-
-            if (!std::holds_alternative<Numeric>(res))
-            {
-                if (end != m_End && end != m_Cursor)
-                    throw Exception_Iter(std::prev(end), "Expected line number to be numeric");
-                else
-                    throw Exception_Iter(m_Cursor, "Expected line number to be numeric");
-            }
-
-            m_NextLine = (int)std::get<Numeric>(res).value;
-            m_Cursor = end;
-        }
-        catch (const Exception_Iter& e)
-        {
-            throw e;
-        }
+        // <line>
+        m_NextLine = ParseJumpTarget();
 	}
 }
@@ -0,0 +1,325 @@
+#include "../Include/Kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <system_error>
+
+#if !defined(BASIC_LONG_DOUBLE) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64))
+	#include <emmintrin.h>
+	#define BASIC_KERNELS_SSE2
+#elif !defined(BASIC_LONG_DOUBLE) && defined(__ARM_NEON) && defined(__aarch64__)
+	#include <arm_neon.h>
+	#define BASIC_KERNELS_NEON
+#endif
+
+namespace Basic
+{
+	namespace Kernels
+	{
+		// Result is NaN if any of the values is NaN, std::min and std::max return one of them
+		static Real Smaller(Real a, Real b) { return std::isnan(a) || a <= b ? a : b; }
+		static Real Larger(Real a, Real b) { return std::isnan(a) || a >= b ? a : b; }
+
+		// Values that are processed by one instruction
+		struct Pack
+		{
+#if defined(BASIC_KERNELS_SSE2)
+			static constexpr size_t SIZE = 2;
+			__m128d value;
+
+			static Pack Load(const Real* p) { return { _mm_loadu_pd(p) }; }
+			static Pack Set(Real v) { return { _mm_set1_pd(v) }; }
+			void Store(Real* p) const { _mm_storeu_pd(p, value); }
+
+			friend Pack operator+(Pack a, Pack b) { return { _mm_add_pd(a.value, b.value) }; }
+			friend Pack operator-(Pack a, Pack b) { return { _mm_sub_pd(a.value, b.value) }; }
+			friend Pack operator*(Pack a, Pack b) { return { _mm_mul_pd(a.value, b.value) }; }
+			// Lanes where a or b is NaN are set to all ones, which is NaN too
+			friend Pack Smaller(Pack a, Pack b) { return { _mm_or_pd(_mm_min_pd(a.value, b.value), _mm_cmpunord_pd(a.value, b.value)) }; }
+			friend Pack Larger(Pack a, Pack b) { return { _mm_or_pd(_mm_max_pd(a.value, b.value), _mm_cmpunord_pd(a.value, b.value)) }; }
+#elif defined(BASIC_KERNELS_NEON)
+			static constexpr size_t SIZE = 2;
+			float64x2_t value;
+
+			static Pack Load(const Real* p) { return { vld1q_f64(p) }; }
+			static Pack Set(Real v) { return { vdupq_n_f64(v) }; }
+			void Store(Real* p) const { vst1q_f64(p, value); }
+
+			friend Pack operator+(Pack a, Pack b) { return { vaddq_f64(a.value, b.value) }; }
+			friend Pack operator-(Pack a, Pack b) { return { vsubq_f64(a.value, b.value) }; }
+			friend Pack operator*(Pack a, Pack b) { return { vmulq_f64(a.value, b.value) }; }
+			// FMIN and FMAX return NaN if any of the operands is NaN
+			friend Pack Smaller(Pack a, Pack b) { return { vminq_f64(a.value, b.value) }; }
+			friend Pack Larger(Pack a, Pack b) { return { vmaxq_f64(a.value, b.value) }; }
+#else
+			// Scalar fallback, the compiler can still vectorise the loops
+			static constexpr size_t SIZE = 1;
+			Real value;
+
+			static Pack Load(const Real* p) { return { *p }; }
+			static Pack Set(Real v) { return { v }; }
+			void Store(Real* p) const { *p = value; }
+
+			friend Pack operator+(Pack a, Pack b) { return { a.value + b.value }; }
+			friend Pack operator-(Pack a, Pack b) { return { a.value - b.value }; }
+			friend Pack operator*(Pack a, Pack b) { return { a.value * b.value }; }
+			friend Pack Smaller(Pack a, Pack b) { return { Kernels::Smaller(a.value, b.value) }; }
+			friend Pack Larger(Pack a, Pack b) { return { Kernels::Larger(a.value, b.value) }; }
+#endif
+		};
+
+		// Number of packs that are accumulated independently, so an operation
+		// doesn't wait for the result of the previous one
+		constexpr size_t ACCUMULATORS = 4;
+
+		// Combines values of the lanes of the pack
+		template <class Func>
+		static Real Reduce(Pack pack, Func func)
+		{
+			Real lanes[Pack::SIZE];
+			pack.Store(lanes);
+
+			Real result = lanes[0];
+
+			for (size_t i = 1; i < Pack::SIZE; i++)
+				result = func(result, lanes[i]);
+
+			return result;
+		}
+
+		// Folds values with func starting from init, func must be associative
+		template <class Func>
+		static Real Fold(const Real* values, size_t count, Real init, Func func)
+		{
+			Pack acc[ACCUMULATORS];
+
+			for (Pack& pack : acc)
+				pack = Pack::Set(init);
+
+			size_t i = 0;
+
+			for (; i + ACCUMULATORS * Pack::SIZE <= count; i += ACCUMULATORS * Pack::SIZE)
+			{
+				for (size_t k = 0; k < ACCUMULATORS; k++)
+					acc[k] = func(acc[k], Pack::Load(values + i + k * Pack::SIZE));
+			}
+
+			for (; i + Pack::SIZE <= count; i += Pack::SIZE)
+				acc[0] = func(acc[0], Pack::Load(values + i));
+
+			for (size_t k = 1; k < ACCUMULATORS; k++)
+				acc[0] = func(acc[0], acc[k]);
+
+			Real result = Reduce(acc[0], func);
+
+			for (; i < count; i++)
+				result = func(result, values[i]);
+
+			return result;
+		}
+
+		// Applies func to the packs and then to the rest of the values that doesn't fill a pack
+		template <class Func>
+		static void Map(Real* out, const Real* lhs, const Real* rhs, size_t count, Func func)
+		{
+			size_t i = 0;
+
+			for (; i + Pack::SIZE <= count; i += Pack::SIZE)
+				func(Pack::Load(lhs + i), Pack::Load(rhs + i)).Store(out + i);
+
+			for (; i < count; i++)
+				out[i] = func(lhs[i], rhs[i]);
+		}
+
+		void Add(Real* out, const Real* lhs, const Real* rhs, size_t count)
+		{
+			Map(out, lhs, rhs, count, [](auto a, auto b) { return a + b; });
+		}
+
+		void Subtract(Real* out, const Real* lhs, const Real* rhs, size_t count)
+		{
+			Map(out, lhs, rhs, count, [](auto a, auto b) { return a - b; });
+		}
+
+		void Scale(Real* out, Real factor, const Real* values, size_t count)
+		{
+			const Pack packed = Pack::Set(factor);
+			size_t i = 0;
+
+			for (; i + Pack::SIZE <= count; i += Pack::SIZE)
+				(packed * Pack::Load(values + i)).Store(out + i);
+
+			for (; i < count; i++)
+				out[i] = factor * values[i];
+		}
+
+		void Multiply(Real* out, const Real* lhs, const Real* rhs, size_t rows, size_t inner, size_t cols)
+		{
+			// Rows of rhs are read sequentially so the inner loop goes over the columns
+			for (size_t i = 0; i < rows; i++)
+			{
+				Real* row = out + i * cols;
+				std::fill(row, row + cols, (Real)0.0);
+
+				for (size_t k = 0; k < inner; k++)
+				{
+					const Real factor = lhs[i * inner + k];
+					const Pack packed = Pack::Set(factor);
+					const Real* source = rhs + k * cols;
+
+					size_t j = 0;
+
+					for (; j + Pack::SIZE <= cols; j += Pack::SIZE)
+						(Pack::Load(row + j) + packed * Pack::Load(source + j)).Store(row + j);
+
+					for (; j < cols; j++)
+						row[j] += factor * source[j];
+				}
+			}
+		}
+
+		Real Sum(const Real* values, size_t count)
+		{
+			return Fold(values, count, 0.0, [](auto a, auto b) { return a + b; });
+		}
+
+		Real Dot(const Real* lhs, const Real* rhs, size_t count)
+		{
+			Pack acc[ACCUMULATORS];
+
+			for (Pack& pack : acc)
+				pack = Pack::Set(0.0);
+
+			size_t i = 0;
+
+			for (; i + ACCUMULATORS * Pack::SIZE <= count; i += ACCUMULATORS * Pack::SIZE)
+			{
+				for (size_t k = 0; k < ACCUMULATORS; k++)
+				{
+					const size_t offset = i + k * Pack::SIZE;
+					acc[k] = acc[k] + Pack::Load(lhs + offset) * Pack::Load(rhs + offset);
+				}
+			}
+
+			for (; i + Pack::SIZE <= count; i += Pack::SIZE)
+				acc[0] = acc[0] + Pack::Load(lhs + i) * Pack::Load(rhs + i);
+
+			Real result = Reduce(acc[0] + acc[1] + acc[2] + acc[3], [](Real a, Real b) { return a + b; });
+
+			for (; i < count; i++)
+				result += lhs[i] * rhs[i];
+
+			return result;
+		}
+
+		Real Min(const Real* values, size_t count)
+		{
+			return Fold(values, count, values[0], [](auto a, auto b) { return Smaller(a, b); });
+		}
+
+		Real Max(const Real* values, size_t count)
+		{
+			return Fold(values, count, values[0], [](auto a, auto b) { return Larger(a, b); });
+		}
+
+		// Smaller parts are sorted faster than threads are started
+		constexpr size_t SORT_PART_SIZE = 1 << 15;
+
+		// Calls func(0) ... func(tasks - 1) in separate threads and waits for them
+		template <class Func>
+		static void RunTasks(size_t tasks, Func func)
+		{
+			std::vector<std::thread> workers;
+
+			for (size_t i = 1; i < tasks; i++)
+			{
+				try
+				{
+					workers.emplace_back(func, i);
+				}
+				catch (const std::system_error&)
+				{
+					// No more threads so the task is done by this one
+					func(i);
+				}
+			}
+
+			func(0);
+
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+
+		template <class Compare>
+		static void SortWith(Real* values, size_t count, Compare compare)
+		{
+			const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+			// Number of parts is a power of 2 so they can be merged in pairs
+			size_t parts = 1;
+
+			while (parts * 2 <= threads && count / (parts * 2) >= SORT_PART_SIZE)
+				parts *= 2;
+
+			if (parts == 1)
+			{
+				std::sort(values, values + count, compare);
+				return;
+			}
+
+			std::vector<size_t> bounds(parts + 1);
+
+			for (size_t i = 0; i <= parts; i++)
+				bounds[i] = count * i / parts;
+
+			RunTasks(parts, [&](size_t i)
+				{
+					std::sort(values + bounds[i], values + bounds[i + 1], compare);
+				});
+
+			for (size_t width = 1; width < parts; width *= 2)
+			{
+				RunTasks(parts / (width * 2), [&](size_t i)
+					{
+						const size_t first = i * width * 2;
+						std::inplace_merge(values + bounds[first], values + bounds[first + width], values + bounds[first + width * 2], compare);
+					});
+			}
+		}
+
+		void Sort(Real* values, size_t count, bool descending)
+		{
+			// NaN isn't ordered with any value, so NaNs go to the end and only the rest is sorted
+			const size_t ordered = std::partition(values, values + count, [](Real v) { return !std::isnan(v); }) - values;
+
+			if (descending)
+				SortWith(values, ordered, std::greater<Real>());
+			else
+				SortWith(values, ordered, std::less<Real>());
+		}
+
+		void Transpose(Real* out, const Real* values, size_t rows, size_t cols)
+		{
+			// Blocks keep both the source and the destination in the cache
+			constexpr size_t BLOCK = 16;
+
+			for (size_t i0 = 0; i0 < rows; i0 += BLOCK)
+			{
+				for (size_t j0 = 0; j0 < cols; j0 += BLOCK)
+				{
+					const size_t iEnd = std::min(i0 + BLOCK, rows);
+					const size_t jEnd = std::min(j0 + BLOCK, cols);
+
+					for (size_t i = i0; i < iEnd; i++)
+					{
+						for (size_t j = j0; j < jEnd; j++)
+							out[j * rows + i] = values[i * cols + j];
+					}
+				}
+			}
+		}
+	}
+}
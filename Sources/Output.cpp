@@ -0,0 +1,473 @@
+#include "../Include/Output.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+	#include <io.h>
+	#define BASIC_ISATTY(fd) _isatty(fd)
+#else
+	#include <unistd.h>
+	#define BASIC_ISATTY(fd) isatty(fd)
+#endif
+
+namespace Basic
+{
+	char* Real_Format(Real value, char* text, bool single)
+	{
+		char* const end = text + REAL_FORMAT_SIZE;
+
+		// -0 is printed as 0
+		if (value == 0.0)
+			value = 0.0;
+
+		if (!(value < 0.0))
+			*text++ = ' ';
+
+		std::to_chars_result result;
+
+		// Integers are written with all digits while they are exact, e.g. 1000000 and not 1e+06
+		const bool exact = std::fabs(value) < (Real)1e16;
+
+		if (exact && value == std::trunc(value))
+			result = std::to_chars(text, end, (long long)value);
+		else if (exact)
+			result = single ? std::to_chars(text, end, (float)value) : std::to_chars(text, end, value);
+		else
+		{
+			// The fixed notation would write all binary digits of big values, e.g. 12345678901234567168
+			const auto format = std::chars_format::scientific;
+			result = single ? std::to_chars(text, end, (float)value, format) : std::to_chars(text, end, value, format);
+		}
+
+		for (char* c = text; c != result.ptr; c++)
+		{
+			if (*c == 'e')
+				*c = 'E';
+		}
+
+		return result.ptr;
+	}
+
+	// Characters of a string field, returns false if there is no field at i
+	static bool ParseStringField(std::string_view text, size_t& i, UsingFormat::Field& field)
+	{
+		using Kind = UsingFormat::Field::Kind;
+
+		switch (text[i])
+		{
+		case '!': field.kind = Kind::FirstChar; i++; return true;
+		case '&': field.kind = Kind::WholeString; i++; return true;
+
+		case '\\':
+		{
+			size_t end = i + 1;
+
+			while (end < text.size() && text[end] == ' ')
+				end++;
+
+			if (end == text.size() || text[end] != '\\')
+				return false;
+
+			field.kind = Kind::FixedString;
+			field.width = (int)(end - i + 1);
+
+			i = end + 1;
+		}
+		return true;
+
+		default: return false;
+		}
+	}
+
+	// Characters of a numeric field, returns false if there is no field at i
+	static bool ParseNumberField(std::string_view text, size_t& i, UsingFormat::Field& field)
+	{
+		auto At = [&](size_t k)
+			{
+				return k < text.size() ? text[k] : '\0';
+			};
+
+		size_t k = i;
+
+		if (At(k) == '+')
+		{
+			field.leadingPlus = true;
+			k++;
+		}
+
+		if (At(k) == '*' && At(k + 1) == '*')
+		{
+			field.asterisks = true;
+			field.digits += 2;
+			k += 2;
+
+			if (At(k) == '$')
+			{
+				field.dollar = true;
+				field.digits++;
+				k++;
+			}
+		}
+		else if (At(k) == '$' && At(k + 1) == '$')
+		{
+			field.dollar = true;
+			field.digits += 2;
+			k += 2;
+		}
+
+		bool found = field.digits > 0;
+
+		// Commas are only counted between the digits, e.g. #,###
+		while (At(k) == '#' || (found && At(k) == ',' && (At(k + 1) == '#' || At(k + 1) == ',' || At(k + 1) == '.')))
+		{
+			if (At(k) == ',')
+				field.comma = true;
+
+			field.digits++;
+			found = true;
+			k++;
+		}
+
+		if (At(k) == '.' && (found || At(k + 1) == '#'))
+		{
+			field.decimals = 0;
+			k++;
+
+			while (At(k) == '#')
+			{
+				field.decimals++;
+				k++;
+			}
+
+			found = true;
+		}
+
+		if (!found)
+			return false;
+
+		if (text.substr(k, 4) == "^^^^")
+		{
+			field.exponent = true;
+			k += 4;
+		}
+
+		if (!field.leadingPlus && (At(k) == '+' || At(k) == '-'))
+		{
+			field.trailingPlus = At(k) == '+';
+			field.trailingMinus = At(k) == '-';
+			k++;
+		}
+
+		i = k;
+		return true;
+	}
+
+	UsingFormat UsingFormat::Parse(std::string_view text)
+	{
+		UsingFormat format;
+		std::string literal;
+
+		size_t i = 0;
+
+		while (i < text.size())
+		{
+			Field field;
+
+			if (ParseStringField(text, i, field) || ParseNumberField(text, i, field))
+			{
+				field.prefix = std::move(literal);
+				literal.clear();
+
+				format.fields.push_back(std::move(field));
+				continue;
+			}
+
+			// _ makes the next character a part of the text
+			if (text[i] == '_' && i + 1 < text.size())
+				i++;
+
+			literal.push_back(text[i++]);
+		}
+
+		format.suffix = std::move(literal);
+
+		return format;
+	}
+
+	Output::Output(std::ostream& stream, size_t capacity) : m_Stream(stream), m_Capacity(capacity)
+	{
+		m_Buffer.reserve(capacity);
+
+		// Only std::cout is known to be connected to the standard output
+		m_LineBuffered = &stream == &std::cout && BASIC_ISATTY(1);
+	}
+
+	Output::~Output()
+	{
+		Flush();
+	}
+
+	void Output::Write(std::string_view text)
+	{
+		m_Buffer.append(text);
+
+		if (m_Buffer.size() >= m_Capacity)
+			Flush();
+	}
+
+	void Output::Write(Real value, bool single)
+	{
+		char text[REAL_FORMAT_SIZE + 1];
+
+		char* end = Real_Format(value, text, single);
+		*end++ = ' ';
+
+		Write(std::string_view(text, end - text));
+	}
+
+	// Shortest decimal digits of the value, value = 0.<digits> * 10^point
+	static std::string DecimalDigits(Real value, int& point)
+	{
+		std::string digits;
+		point = 0;
+
+		if (value == 0.0)
+			return digits;
+
+		char buffer[REAL_FORMAT_SIZE];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific);
+
+		// d.ddde+XX
+		const char* c = buffer;
+
+		for (; c != result.ptr && *c != 'e'; c++)
+		{
+			if (*c != '.')
+				digits.push_back(*c);
+		}
+
+		// from_chars doesn't accept the plus sign
+		if (c != result.ptr && *++c == '+')
+			c++;
+
+		std::from_chars(c, result.ptr, point);
+		point++;
+
+		return digits;
+	}
+
+	// Leaves count digits rounding half up like MSX BASIC does, a carry adds a digit at the front
+	static void RoundDigits(std::string& digits, int& point, int count)
+	{
+		if (count < 0)
+		{
+			digits.clear();
+			return;
+		}
+
+		if ((size_t)count >= digits.size())
+		{
+			digits.append(count - digits.size(), '0');
+			return;
+		}
+
+		const bool up = digits[count] >= '5';
+		digits.resize(count);
+
+		if (!up)
+			return;
+
+		int k = count - 1;
+
+		for (; k >= 0 && digits[k] == '9'; k--)
+			digits[k] = '0';
+
+		if (k >= 0)
+			digits[k]++;
+		else
+		{
+			digits.insert(digits.begin(), '1');
+			point++;
+		}
+	}
+
+	void Output::WriteUsing(const UsingFormat::Field& field, Real value)
+	{
+		const bool negative = value < 0.0;
+		const bool hasSign = field.leadingPlus || field.trailingPlus || field.trailingMinus;
+
+		const int decimals = std::max(field.decimals, 0);
+
+		int point;
+		std::string digits = DecimalDigits(std::fabs(value), point);
+
+		// Digit at the position k from the start of the digits, zeros are around them
+		auto Digit = [&](int k)
+			{
+				return 0 <= k && k < (int)digits.size() ? digits[k] : '0';
+			};
+
+		std::string integral, fraction, exponent;
+
+		if (field.exponent)
+		{
+			// One position is left for the sign if the field doesn't have one
+			const int before = std::max(field.digits - (hasSign ? 0 : 1), 0);
+			const int precision = std::max(before + decimals, 1);
+
+			RoundDigits(digits, point, precision);
+
+			// Carry made one more digit
+			digits.resize(precision);
+
+			for (int k = 0; k < before; k++)
+				integral.push_back(Digit(k));
+
+			for (int k = before; k < precision; k++)
+				fraction.push_back(Digit(k));
+
+			const int power = value == 0.0 ? 0 : point - before;
+
+			exponent = power < 0 ? "E-" : "E+";
+
+			if (std::abs(power) < 10)
+				exponent.push_back('0');
+
+			exponent += std::to_string(std::abs(power));
+		}
+		else
+		{
+			// Too big to be written without the exponent
+			if (point > (int)REAL_FORMAT_SIZE)
+			{
+				char text[REAL_FORMAT_SIZE];
+				char* end = Real_Format(value, text);
+
+				// Without the space of the sign
+				const char* start = text[0] == ' ' ? text + 1 : text;
+
+				Write("%");
+				Write(std::string_view(start, end - start));
+				return;
+			}
+
+			RoundDigits(digits, point, point + decimals);
+
+			if (point <= 0)
+				integral = "0";
+
+			for (int k = 0; k < point; k++)
+			{
+				// Commas go between groups of 3 digits
+				if (field.comma && k > 0 && (point - k) % 3 == 0)
+					integral.push_back(',');
+
+				integral.push_back(Digit(k));
+			}
+
+			for (int k = point; k < point + decimals; k++)
+				fraction.push_back(Digit(k));
+		}
+
+		auto Build = [&]()
+			{
+				std::string text;
+
+				if (field.leadingPlus)
+					text.push_back(negative ? '-' : '+');
+				else if (!hasSign && negative)
+					text.push_back('-');
+
+				if (field.dollar)
+					text.push_back('$');
+
+				text += integral;
+
+				if (field.decimals >= 0)
+				{
+					text.push_back('.');
+					text += fraction;
+				}
+
+				text += exponent;
+
+				if (field.trailingPlus)
+					text.push_back(negative ? '-' : '+');
+				else if (field.trailingMinus)
+					text.push_back(negative ? '-' : ' ');
+
+				return text;
+			};
+
+		const size_t width = field.digits + (field.decimals >= 0 ? field.decimals + 1 : 0) +
+			(hasSign ? 1 : 0) + (field.exponent ? 4 : 0);
+
+		std::string text = Build();
+
+		// 0 before the point is left out if there is no place for it, e.g. .25 for .##
+		if (text.size() > width && integral == "0")
+		{
+			integral.clear();
+			text = Build();
+		}
+
+		if (text.size() > width)
+		{
+			Write("%");
+			Write(text);
+			return;
+		}
+
+		m_Buffer.append(width - text.size(), field.asterisks ? '*' : ' ');
+		Write(text);
+	}
+
+	void Output::WriteUsing(const UsingFormat::Field& field, std::string_view text)
+	{
+		using Kind = UsingFormat::Field::Kind;
+
+		switch (field.kind)
+		{
+		case Kind::FirstChar:
+			Write(text.empty() ? std::string_view(" ") : text.substr(0, 1));
+		break;
+
+		case Kind::FixedString:
+		{
+			const size_t width = field.width;
+
+			Write(text.substr(0, width));
+
+			if (text.size() < width)
+				m_Buffer.append(width - text.size(), ' ');
+		}
+		break;
+
+		default:
+			Write(text);
+		break;
+		}
+	}
+
+	void Output::NewLine()
+	{
+		m_Buffer.push_back('\n');
+
+		if (m_LineBuffered || m_Buffer.size() >= m_Capacity)
+			Flush();
+	}
+
+	void Output::Flush()
+	{
+		if (!m_Buffer.empty())
+		{
+			m_Stream.write(m_Buffer.data(), m_Buffer.size());
+			m_Buffer.clear();
+		}
+
+		m_Stream.flush();
+	}
+}
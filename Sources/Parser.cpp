@@ -1,4 +1,7 @@
 #include "../Include/Parser.hpp"
+#include "../Include/Keywords.hpp"
+
+#include <charconv>
 
 namespace Basic
 {
@@ -11,13 +14,52 @@ namespace Basic
 		}
 	}
 
-    void Parser::Tokenise(const std::string& input, std::vector<Token>& tokens)
+    static Real ParseNumber(Token::Type type, std::string_view text)
+    {
+        int base = 10;
+
+        switch (type)
+        {
+        case Token::Type::Literal_NumericBase16: base = 16; break;
+        case Token::Type::Literal_NumericBase8:  base = 8; break;
+        case Token::Type::Literal_NumericBase2:  base = 2; break;
+        default:                                 return Real_Parse(std::string(text));
+        }
+
+        Integer number;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number, base);
+
+        if (error != std::errc() || end != text.data() + text.size())
+            throw std::out_of_range("Invalid numeric literal");
+
+        return (Real)number;
+    }
+
+    Parser::Parser(LiteralPool& pool) : m_Pool(pool)
+    {
+
+    }
+
+    void Parser::Tokenise(std::string_view input, std::vector<Token>& tokens)
 	{
 		State stateNow = State::NewToken;
 		State stateNext = State::NewToken;
 
 		Token token;
 
+		// Text of the current token is a span of the input,
+		// only symbols are copied to be converted to the upper case
+		size_t start = 0;
+		size_t length = 0;
+
+		std::string upper;
+		bool isUpper = false;
+
+		auto Value = [&]()
+			{
+				return isUpper ? std::string_view(upper) : input.substr(start, length);
+			};
+
 		auto currentChar = input.begin();
 
 		// If they remain 0 at the end then ok
@@ -26,70 +68,80 @@ namespace Basic
 
 		auto ClassifyKeyword = [&]()
 		{
-			String_ToUpper(token.value);
+			auto keyword = Keywords::KeywordTable.Find(input.substr(start, length));
 
-			static const std::unordered_map<std::string, Token::Type> s_KeywordMap =
+			if (keyword)
 			{
-				{"PRINT", Token::Type::Keyword_Print},
-				{"INPUT", Token::Type::Keyword_Input},
-				{"CLS", Token::Type::Keyword_Cls},
-				{"LET", Token::Type::Keyword_Let},
-				{"REM", Token::Type::Keyword_Rem},
-				{"GOTO", Token::Type::Keyword_Goto},
-				{"IF", Token::Type::Keyword_If},
-				{"THEN", Token::Type::Keyword_Then},
-				{"ELSE", Token::Type::Keyword_Else},
-				{"FOR", Token::Type::Keyword_For},
-				{"TO", Token::Type::Keyword_To},
-				{"STEP", Token::Type::Keyword_Step},
-				{"NEXT", Token::Type::Keyword_Next},
-				{"SLEEP", Token::Type::Keyword_Sleep},
-				{"SIN", Token::Type::Keyword_Sin},
-				{"COS", Token::Type::Keyword_Cos},
-				{"TAN", Token::Type::Keyword_Tan},
-				{"ARCSIN", Token::Type::Keyword_ArcSin},
-				{"ARCCOS", Token::Type::Keyword_ArcCos},
-				{"ARCTAN", Token::Type::Keyword_ArcTan},
-				{"SQR", Token::Type::Keyword_Sqrt},
-				{"LN", Token::Type::Keyword_Ln},
-				{"LOG", Token::Type::Keyword_Log},
-				{"EXP", Token::Type::Keyword_Exp},
-				{"ABS", Token::Type::Keyword_Abs},
-				{"SGN", Token::Type::Keyword_Sign},
-				{"INT", Token::Type::Keyword_Int},
-				{"RND", Token::Type::Keyword_Random},
-				{"END", Token::Type::Keyword_End},
-				{"GOSUB", Token::Type::Keyword_GoSub},
-				{"RETURN", Token::Type::Keyword_Return},
-				{"VAL", Token::Type::Keyword_Val},
-				{"LIST", Token::Type::Keyword_List},
-				{"RUN", Token::Type::Keyword_Run},
-				{"NEW", Token::Type::Keyword_New},
-				{"LOAD", Token::Type::Keyword_Load},
-				{"DIM", Token::Type::Keyword_Dim},
-				{"AND", Token::Type::Operator},
-				{"OR", Token::Type::Operator}
-			};
-
-			auto it = s_KeywordMap.find(token.value);
+				token.type = keyword->value;
+				upper = keyword->name;
+			}
+			else
+			{
+				// Names of variables don't depend on letters case
+				upper.assign(input.substr(start, length));
+				String_ToUpper(upper);
+			}
 
-			if (it != s_KeywordMap.end())
-				token.type = it->second;
+			isUpper = true;
 		};
 
+		// Tokens that were already in the vector don't belong to this line
+		const size_t firstToken = tokens.size();
+
+		// Numeric literals and operators are decoded once here so the evaluator doesn't parse strings
+		auto PushToken = [&]()
+			{
+				std::string_view value = Value();
+
+				if (token.type == Token::Type::Operator)
+				{
+					Token::Type prev = tokens.size() > firstToken ? tokens.back().type : Token::Type::None;
+
+					// + or - is unary if there is no left operand before it
+					bool unary = (value == "+" || value == "-") &&
+						!(prev == Token::Type::Literal_NumericBase16 ||
+						prev == Token::Type::Literal_NumericBase10 ||
+						prev == Token::Type::Literal_NumericBase8 ||
+						prev == Token::Type::Literal_NumericBase2 ||
+						prev == Token::Type::Literal_String ||
+						prev == Token::Type::Symbol ||
+						prev == Token::Type::Parenthesis_Close);
+
+					const char unaryName[] = { 'U', value.empty() ? ' ' : value[0] };
+					token.op = Keywords::OperatorTable.Find(unary ? std::string_view(unaryName, 2) : value)->value;
+				}
+				else if (token.type == Token::Type::Literal_String)
+					token.literal = m_Pool.AddString(value);
+				else if (token.IsNumeric())
+				{
+					try
+					{
+						token.literal = m_Pool.AddNumber(ParseNumber(token.type, value));
+					}
+					catch (const std::exception&)
+					{
+						throw Exception(input, (int)std::distance(input.begin(), currentChar), "Invalid numeric literal: " + std::string(value));
+					}
+				}
+
+				token.text = m_Pool.AddText(value);
+				tokens.push_back(token);
+			};
+
 		auto StartToken = [&](Token::Type type, State nextState = State::CompleteToken, bool push = true)
 			{
 				token.type = type;
 
-				if (push)
-					token.value.push_back(*currentChar);
+				// The text starts after the character if it's not a part of the token
+				start = std::distance(input.begin(), currentChar) + (push ? 0 : 1);
+				length = push ? 1 : 0;
 
 				stateNext = nextState;
 			};
 
 		auto AppendChar = [&](State nextState)
 			{
-				token.value += *currentChar;
+				length++;
 				stateNext = nextState;
 				currentChar++;
 			};
@@ -208,12 +260,15 @@ namespace Basic
 							SetNumericBase(16);
 						else if (*currentChar == 'o' || *currentChar == 'O')
 							SetNumericBase(8);
+						else if (*currentChar == 'b' || *currentChar == 'B')
+							SetNumericBase(2);
 
 						currentChar++;
+						start++;
 					}
 					else
 					{
-						// If there is no H or O after the & then number must be treated as a binary
+						// If there is no H, O or B after the & then number must be treated as a binary
 						
 						if (*currentChar == '0' || *currentChar == '1')
 						{
@@ -298,18 +353,15 @@ namespace Basic
 					if (Guard::Operators[*currentChar])
 					{
 						// If we found an operator then continue searching for a longer operator
-						if (s_Operators.contains(token.value + *currentChar))
+						if (Keywords::OperatorTable.Find(input.substr(start, length + 1)))
 							AppendChar(State::Operator);
 						else
 						{
 							// If we don't have an operator with the currently appended character then
 							// proceed with the current operator
 
-							if (s_Operators.contains(token.value))
-							{
-								String_ToUpper(token.value);
+							if (Keywords::OperatorTable.Find(Value()))
 								stateNext = State::CompleteToken;
-							}
 							else
 							{
 								// If on the current stage we still can't find an operator
@@ -325,10 +377,10 @@ namespace Basic
 						// If current character is not a part of the operator characters
 						// and current text is a valid operator say that it's done
 
-						if (s_Operators.contains(token.value))
+						if (Keywords::OperatorTable.Find(Value()))
 							stateNext = State::CompleteToken;
 						else
-                            throw Exception(input, (int)std::distance(input.begin(), currentChar), "Invalid operator was found: " + token.value);
+                            throw Exception(input, (int)std::distance(input.begin(), currentChar), "Invalid operator was found: " + std::string(Value()));
 					}
 				}
 				break;
@@ -337,7 +389,10 @@ namespace Basic
 				{
 					// Note: we treat all invalid symbols (e.g. 123abc) in the Literal_Numeric state
 
-					if (Guard::Symbols[*currentChar] || Guard::DecDigits[*currentChar])
+					// Type suffix (e.g. A%, NAME$) can only be the last character of the name
+					const bool suffixed = Guard::TypeSuffixes[input[start + length - 1]];
+
+					if (!suffixed && (Guard::Symbols[*currentChar] || Guard::DecDigits[*currentChar] || Guard::TypeSuffixes[*currentChar]))
 						AppendChar(State::Symbol);
 					else
 					{
@@ -357,10 +412,11 @@ namespace Basic
 				case State::CompleteToken:
 				{
 					stateNext = State::NewToken;
-					tokens.push_back(token);
+					PushToken();
 
-					token.type = Token::Type::None;
-					token.value.clear();
+					token = Token();
+					length = 0;
+					isUpper = false;
 				}
 				break;
                         
@@ -382,28 +438,7 @@ namespace Basic
             throw Exception(input, (int)std::distance(input.begin(), currentChar), "Quotes were not balanced");
 
 		// Drain out the last token
-		if (!token.value.empty())
-			tokens.push_back(token);
+		if (length > 0)
+			PushToken();
 	}
-
-	std::unordered_map<std::string, Operator> Parser::s_Operators =
-	{
-		{"=", { Operator::Type::Assign, 0, 2 } },
-		{"AND", { Operator::Type::And, 1, 2 } },
-		{"OR", { Operator::Type::Or, 2, 2 } },
-		{"==", { Operator::Type::Equals, 3, 2 } },
-		{"<>", { Operator::Type::NotEquals, 3, 2 } },
-		{"<", { Operator::Type::Less, 3, 2 } },
-		{">", { Operator::Type::Greater, 3, 2 } },
-		{"<=", { Operator::Type::LessEquals, 3, 2 } },
-		{">=", { Operator::Type::GreaterEquals, 3, 2 } },
-		{"-", { Operator::Type::Subtraction, 4, 2 } },
-		{"+", { Operator::Type::Addition, 4, 2 } },
-		{"*", { Operator::Type::Multiplication, 5, 2 } },
-		{"/", { Operator::Type::Division, 5, 2 } },
-        {"^", { Operator::Type::Power, 6, 2 } },
-
-		{"u-", { Operator::Type::Subtraction, Operator::MAX_PRECEDENCE, 1 } },
-		{"u+", { Operator::Type::Addition, Operator::MAX_PRECEDENCE, 1 } },
-	};
 }
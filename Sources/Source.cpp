@@ -1,20 +1,48 @@
 ﻿#include <iostream>
 
 #include "../Include/Interpreter.hpp"
+#include "../Include/State.hpp"
 
-int main()
+int main(int argc, char* argv[])
 {
+    // basic <file> [args] runs the file without the prompt
+    if (argc > 1)
+    {
+        Basic::State state;
+
+        std::string command;
+
+        for (int i = 2; i < argc; i++)
+        {
+            if (i > 2)
+                command += ' ';
+
+            command += argv[i];
+        }
+
+        state.SetCommand(command);
+
+        return state.DoFile(argv[1]) ? 0 : 1;
+    }
+
     std::cout << "MSX-like BASIC version 0.1\n";
     std::cout << "Repository: github.com/defini7/BASIC\n" << std::endl;
 
-	Basic::Parser parser;
 	Basic::Interpreter interpreter;
+	Basic::Parser parser(interpreter.GetPool());
+
+	Basic::Output& output = interpreter.GetOutput();
 
 	std::string input;
 
     while (true)
     {
-        std::getline(std::cin, input);
+        // Everything must be seen before waiting for the next line
+        output.Flush();
+
+        // There is nothing to run after the end of the input
+        if (!std::getline(std::cin, input))
+            break;
 
         bool programmMode = false;
 
@@ -34,7 +62,7 @@ int main()
             }
             catch (const Basic::Exception_Iter& e)
             {
-                throw Basic::GenerateException(tokens, input, e);
+                throw Basic::GenerateException(interpreter.GetPool(), tokens, input, e);
             }
             catch (int)
             {
@@ -43,13 +71,18 @@ int main()
 		}
         catch (const Basic::Exception& e)
 		{
+            // Errors come after the text printed before them
+            output.Flush();
 			std::cerr << e.what() << std::endl;
 		}
 
         interpreter.Reset();
 
         if (!programmMode)
-            std::cout << "Ok" << std::endl;
+        {
+            output.Write("Ok");
+            output.NewLine();
+        }
 	}
 
 	return 0;
@@ -1,6 +1,147 @@
 #include "../Include/State.hpp"
+#include "../Include/Tokenised.hpp"
 
-Basic::State::State()
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace Basic
 {
+	State::State() : m_Parser(m_Interpreter.GetPool())
+	{
+
+	}
+
+	bool State::DoFile(std::string_view path)
+	{
+		std::ifstream ifs{ std::string(path), std::ios::binary };
+
+		if (!ifs.is_open())
+		{
+			std::cerr << "Can't open file: " << path << std::endl;
+			return false;
+		}
+
+		// The whole file is read with one call and lines are tokenised in place
+		ifs.seekg(0, std::ios::end);
+		const std::streamoff size = ifs.tellg();
+		ifs.seekg(0);
+
+		// Directories are opened but can't be read, their size is -1 or made up
+		if (size < 0 || (size > 0 && ifs.peek() == std::ifstream::traits_type::eof()))
+		{
+			std::cerr << "Can't open file: " << path << std::endl;
+			return false;
+		}
+
+		std::string source((size_t)size, '\0');
+
+		if (!ifs.read(source.data(), source.size()))
+		{
+			std::cerr << "Can't open file: " << path << std::endl;
+			return false;
+		}
+
+		ifs.close();
+
+		bool immediate = false;
+
+		// Programm saved by SAVE "<path>",B is loaded without parsing and then run
+		if (Tokenised::IsTokenised(source))
+		{
+			if (!m_Interpreter.LoadTokenised(source))
+			{
+				std::cerr << "Programm file is damaged or was saved by another version: " << path << std::endl;
+				return false;
+			}
+
+			return Execute("RUN FAST", immediate);
+		}
+
+		if (!Execute(source, immediate))
+			return false;
+
+		// Files that have commands (e.g. RUN at the end) decide what to do by themselves
+		if (immediate)
+			return true;
+
+		return Execute("RUN FAST", immediate);
+	}
+
+	bool State::DoString(std::string_view source)
+	{
+		bool immediate = false;
+		return Execute(source, immediate);
+	}
+
+	void State::SetCommand(const std::string& command)
+	{
+		m_Interpreter.GetVariables().Set("COMMAND$", String{ command });
+	}
+
+	bool State::Execute(std::string_view source, bool& immediate)
+	{
+		std::string_view rest = source;
+		std::vector<Token> tokens;
+
+		bool success = true;
+
+		while (success && !rest.empty())
+		{
+			size_t lineEnd = rest.find('\n');
+			std::string_view line = rest.substr(0, lineEnd);
+
+			rest = lineEnd == std::string_view::npos ? std::string_view() : rest.substr(lineEnd + 1);
+
+			if (!line.empty() && line.back() == '\r')
+				line.remove_suffix(1);
+
+			tokens.clear();
+
+			try
+			{
+				try
+				{
+					m_Parser.Tokenise(line, tokens);
+
+					if (tokens.empty())
+						continue;
+
+					bool programmMode = false;
+
+					do
+					{
+						programmMode = m_Interpreter.RunLine(tokens);
+					}
+					while (!m_Interpreter.IsEnd());
+
+					immediate |= !programmMode;
+				}
+				catch (const Exception_Iter& e)
+				{
+					throw GenerateException(m_Interpreter.GetPool(), tokens, std::string(line), e);
+				}
+				catch (int)
+				{
+					// RUN and END finish this way
+					immediate = true;
+				}
+			}
+			catch (const Exception& e)
+			{
+				// Errors come after the text printed before them
+				m_Interpreter.GetOutput().Flush();
+				std::cerr << e.what() << std::endl;
+
+				success = false;
+			}
+
+			m_Interpreter.Reset();
+		}
+
+		m_Interpreter.GetOutput().Flush();
 
+		return success;
+	}
 }
@@ -3,8 +3,6 @@
 
 namespace Basic
 {
-    Token::Token(Type type, const std::string_view value) : type(type), value(value) {}
-
     bool Token::IsFunction() const
     {
         switch (type)
@@ -24,6 +22,38 @@ namespace Basic
         case Token::Type::Keyword_Int:
         case Token::Type::Keyword_Random:
         case Token::Type::Keyword_Val:
+        case Token::Type::Keyword_Str:
+            return true;
+
+        default:
+            return IsReduction();
+        }
+    }
+
+    bool Token::IsReduction() const
+    {
+        switch (type)
+        {
+        case Token::Type::Keyword_Sum:
+        case Token::Type::Keyword_Dot:
+        case Token::Type::Keyword_MinA:
+        case Token::Type::Keyword_MaxA:
+        case Token::Type::Keyword_Mean:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    bool Token::IsNumeric() const
+    {
+        switch (type)
+        {
+        case Token::Type::Literal_NumericBase16:
+        case Token::Type::Literal_NumericBase10:
+        case Token::Type::Literal_NumericBase8:
+        case Token::Type::Literal_NumericBase2:
             return true;
 
         default:
@@ -31,7 +61,35 @@ namespace Basic
         }
     }
 
-    std::string TokensToString(const std::vector<Token>& tokens)
+    int LiteralPool::AddText(std::string_view text)
+    {
+        auto it = m_TextIndices.find(text);
+
+        if (it != m_TextIndices.end())
+            return it->second;
+
+        m_Texts.emplace_back(std::string(text));
+        m_TextIndices.emplace(*m_Texts.back().value, (int)m_Texts.size() - 1);
+
+        return (int)m_Texts.size() - 1;
+    }
+
+    int LiteralPool::AddNumber(Real value)
+    {
+        auto [it, inserted] = m_NumberIndices.try_emplace(value, (int)m_Numbers.size());
+
+        if (inserted)
+            m_Numbers.push_back(value);
+
+        return it->second;
+    }
+
+    int LiteralPool::AddString(std::string_view text)
+    {
+        return AddText(text);
+    }
+
+    std::string TokensToString(const std::vector<Token>& tokens, const LiteralPool& pool)
     {
         std::stringstream ss;
 
@@ -39,10 +97,15 @@ namespace Basic
         {
             ss << ' ';
 
-            if (token.type == Basic::Token::Type::Literal_String)
-                ss << '"' << token.value << '"';
-            else
-                ss << token.value;
+            // Prefixes of the literals are not a part of their text
+            switch (token.type)
+            {
+            case Basic::Token::Type::Literal_String: ss << '"' << pool.GetText(token) << '"'; break;
+            case Basic::Token::Type::Literal_NumericBase16: ss << "&H" << pool.GetText(token); break;
+            case Basic::Token::Type::Literal_NumericBase8: ss << "&O" << pool.GetText(token); break;
+            case Basic::Token::Type::Literal_NumericBase2: ss << "&B" << pool.GetText(token); break;
+            default: ss << pool.GetText(token); break;
+            }
         }
 
         return ss.str();
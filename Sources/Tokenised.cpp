@@ -0,0 +1,341 @@
+#include "../Include/Tokenised.hpp"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace Basic
+{
+	namespace Tokenised
+	{
+		// Layout of the file:
+		// header: magic, version, size of Real, counts of texts, numbers, strings, lines and tokens, hash of the rest
+		// texts and strings: length and characters, numbers: Real as it's stored in the memory
+		// lines: number and count of the tokens, tokens: all tokens of the lines one after another,
+		// every token is its type, the operator if the high bit of the type is set and indices as varints
+
+		constexpr char MAGIC[4] = { 'B', 'A', 'S', '\x1A' };
+
+		constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 2 + 2 + 5 * 4 + 8;
+
+		// Set in the type of the token if the operator follows it
+		constexpr uint8_t HAS_OPERATOR = 0x80;
+
+		// Must be the last of Token::Type and Operator::Type, other values are rejected by Read
+		constexpr uint8_t LAST_TOKEN_TYPE = (uint8_t)Token::Type::Keyword_Save;
+		constexpr uint8_t LAST_OPERATOR_TYPE = (uint8_t)Operator::Type::Or;
+
+		static_assert(LAST_TOKEN_TYPE < HAS_OPERATOR);
+
+		// FNV-1a finds damaged files
+		static uint64_t Hash(std::string_view data)
+		{
+			uint64_t hash = 14695981039346656037ull;
+
+			for (char c : data)
+			{
+				hash ^= (uint8_t)c;
+				hash *= 1099511628211ull;
+			}
+
+			return hash;
+		}
+
+		// Values are written in the byte order of the machine
+		struct Writer
+		{
+			std::string data;
+
+			template <class T>
+			void Put(T value)
+			{
+				data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			// 7 bits in a byte, most of the indices take one or two bytes
+			void PutVarint(uint32_t value)
+			{
+				while (value >= 0x80)
+				{
+					data.push_back((char)(value | 0x80));
+					value >>= 7;
+				}
+
+				data.push_back((char)value);
+			}
+
+			void PutText(std::string_view text)
+			{
+				Put((uint32_t)text.size());
+				data.append(text);
+			}
+		};
+
+		struct Reader
+		{
+			std::string_view data;
+			size_t position = 0;
+
+			// Position can be set past the end of the data by a damaged file
+			size_t Remaining() const
+			{
+				return position < data.size() ? data.size() - position : 0;
+			}
+
+			template <class T>
+			bool Get(T& value)
+			{
+				if (Remaining() < sizeof(value))
+					return false;
+
+				std::memcpy(&value, data.data() + position, sizeof(value));
+				position += sizeof(value);
+
+				return true;
+			}
+
+			bool GetVarint(uint32_t& value)
+			{
+				value = 0;
+
+				for (int shift = 0; shift < 32 && position < data.size(); shift += 7)
+				{
+					const uint8_t byte = (uint8_t)data[position++];
+					value |= (uint32_t)(byte & 0x7F) << shift;
+
+					if (!(byte & 0x80))
+						return true;
+				}
+
+				return false;
+			}
+
+			bool GetText(std::string_view& text)
+			{
+				uint32_t length;
+
+				if (!Get(length) || Remaining() < length)
+					return false;
+
+				text = data.substr(position, length);
+				position += length;
+
+				return true;
+			}
+		};
+
+		bool IsTokenised(std::string_view data)
+		{
+			return data.size() >= HEADER_SIZE && std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+		}
+
+		std::string Write(const std::map<int, Line>& programm, const LiteralPool& pool)
+		{
+			Writer texts, numbers, strings, lines, tokens;
+
+			// Indices of the pool -> indices in the file
+			std::unordered_map<int, int> textIndices, numberIndices, stringIndices;
+
+			uint32_t tokensCount = 0;
+
+			for (const auto& [number, line] : programm)
+			{
+				lines.Put((int32_t)number);
+				lines.Put((uint32_t)line.tokens.size());
+
+				for (const Token& token : line.tokens)
+				{
+					// Tokens that aren't operators have all fields of the operator set to 0
+					const bool hasOperator = (Byte)token.op.type != 0 || token.op.precedence != 0 || token.op.arguments != 0;
+
+					tokens.Put((uint8_t)((uint8_t)token.type | (hasOperator ? HAS_OPERATOR : 0)));
+
+					if (hasOperator)
+					{
+						tokens.Put((uint8_t)token.op.type);
+						tokens.Put((uint8_t)token.op.precedence);
+						tokens.Put((uint8_t)token.op.arguments);
+					}
+
+					// 0 means that the token doesn't have a text
+					if (token.text >= 0)
+					{
+						auto [it, inserted] = textIndices.try_emplace(token.text, (int)textIndices.size());
+
+						if (inserted)
+							texts.PutText(pool.GetText(token));
+
+						tokens.PutVarint(it->second + 1);
+					}
+					else
+						tokens.PutVarint(0);
+
+					if (token.IsNumeric())
+					{
+						auto [it, inserted] = numberIndices.try_emplace(token.literal, (int)numberIndices.size());
+
+						if (inserted)
+							numbers.Put(pool.GetNumber(token));
+
+						tokens.PutVarint(it->second);
+					}
+					else if (token.type == Token::Type::Literal_String)
+					{
+						auto [it, inserted] = stringIndices.try_emplace(token.literal, (int)stringIndices.size());
+
+						if (inserted)
+							strings.PutText(*pool.GetString(token).value);
+
+						tokens.PutVarint(it->second);
+					}
+				}
+
+				tokensCount += (uint32_t)line.tokens.size();
+			}
+
+			std::string payload = texts.data + numbers.data + strings.data + lines.data + tokens.data;
+
+			Writer header;
+
+			header.data.append(MAGIC, sizeof(MAGIC));
+			header.Put(VERSION);
+			header.Put((uint8_t)sizeof(Real));
+			header.Put((uint8_t)0);
+			header.Put((uint32_t)textIndices.size());
+			header.Put((uint32_t)numberIndices.size());
+			header.Put((uint32_t)stringIndices.size());
+			header.Put((uint32_t)programm.size());
+			header.Put(tokensCount);
+			header.Put(Hash(payload));
+
+			return header.data + payload;
+		}
+
+		bool Read(std::string_view data, std::map<int, Line>& programm, LiteralPool& pool)
+		{
+			if (!IsTokenised(data))
+				return false;
+
+			Reader reader{ data, sizeof(MAGIC) };
+
+			uint16_t version;
+			uint8_t realSize, reserved;
+			uint32_t textsCount, numbersCount, stringsCount, linesCount, tokensCount;
+			uint64_t hash;
+
+			if (!reader.Get(version) || !reader.Get(realSize) || !reader.Get(reserved) ||
+				!reader.Get(textsCount) || !reader.Get(numbersCount) || !reader.Get(stringsCount) ||
+				!reader.Get(linesCount) || !reader.Get(tokensCount) || !reader.Get(hash))
+				return false;
+
+			if (version != VERSION || realSize != sizeof(Real) || Hash(data.substr(HEADER_SIZE)) != hash)
+				return false;
+
+			// Counts can't be bigger than the data allows, so nothing big is allocated for a damaged file
+			if (textsCount > reader.Remaining() / 4 || numbersCount > reader.Remaining() / sizeof(Real) ||
+				stringsCount > reader.Remaining() / 4 || tokensCount > reader.Remaining())
+				return false;
+
+			// Indices in the file -> indices of the pool
+			std::vector<int> texts(textsCount), numbers(numbersCount), strings(stringsCount);
+
+			for (int& index : texts)
+			{
+				std::string_view text;
+
+				if (!reader.GetText(text))
+					return false;
+
+				index = pool.AddText(text);
+			}
+
+			for (int& index : numbers)
+			{
+				Real value;
+
+				if (!reader.Get(value))
+					return false;
+
+				index = pool.AddNumber(value);
+			}
+
+			for (int& index : strings)
+			{
+				std::string_view text;
+
+				if (!reader.GetText(text))
+					return false;
+
+				index = pool.AddString(text);
+			}
+
+			if (linesCount > reader.Remaining() / 8)
+				return false;
+
+			// Tokens go after all lines
+			Reader tokensReader{ data, reader.position + (size_t)linesCount * 8 };
+
+			uint32_t tokensLeft = tokensCount;
+
+			for (uint32_t i = 0; i < linesCount; i++)
+			{
+				int32_t number;
+				uint32_t count;
+
+				// Every token takes at least 2 bytes
+				if (!reader.Get(number) || !reader.Get(count) || number < 0 || count > tokensLeft || count > tokensReader.Remaining() / 2)
+					return false;
+
+				tokensLeft -= count;
+
+				std::vector<Token> tokens(count);
+
+				for (Token& token : tokens)
+				{
+					uint8_t type;
+					uint32_t text, literal;
+
+					if (!tokensReader.Get(type) || (uint8_t)(type & ~HAS_OPERATOR) > LAST_TOKEN_TYPE)
+						return false;
+
+					token.type = (Token::Type)(type & ~HAS_OPERATOR);
+
+					if (type & HAS_OPERATOR)
+					{
+						uint8_t opType, precedence, arguments;
+
+						if (!tokensReader.Get(opType) || !tokensReader.Get(precedence) || !tokensReader.Get(arguments) || opType > LAST_OPERATOR_TYPE)
+							return false;
+
+						token.op = Operator{ (Operator::Type)opType, precedence, arguments };
+					}
+
+					if (!tokensReader.GetVarint(text) || text > texts.size())
+						return false;
+
+					token.text = text > 0 ? texts[text - 1] : -1;
+
+					// Symbols get their slots when the programm is loaded
+					if (token.IsNumeric())
+					{
+						if (!tokensReader.GetVarint(literal) || literal >= numbers.size())
+							return false;
+
+						token.literal = numbers[literal];
+					}
+					else if (token.type == Token::Type::Literal_String)
+					{
+						if (!tokensReader.GetVarint(literal) || literal >= strings.size())
+							return false;
+
+						token.literal = strings[literal];
+					}
+				}
+
+				programm.insert_or_assign(number, Line(std::move(tokens)));
+			}
+
+			return tokensLeft == 0 && tokensReader.Remaining() == 0;
+		}
+	}
+}
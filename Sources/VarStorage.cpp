@@ -2,21 +2,101 @@
 
 namespace Basic
 {
+	VarType VarType_FromName(std::string_view name)
+	{
+		if (name.empty())
+			return VarType::Any;
+
+		switch (name.back())
+		{
+		case '%': return VarType::Integer;
+		case '!': return VarType::Single;
+		case '#': return VarType::Double;
+		case '$': return VarType::String;
+		default:  return VarType::Any;
+		}
+	}
+
+	// Typed variables exist from the start like in MSX BASIC
+	static std::optional<Object> DefaultValue(VarType type)
+	{
+		switch (type)
+		{
+		case VarType::Any:    return std::nullopt;
+		case VarType::String: return String{ "" };
+		default:              return Numeric{ 0.0 };
+		}
+	}
+
+	int VarStorage::Resolve(const std::string& name)
+	{
+		auto [it, inserted] = m_Slots.try_emplace(name, (int)m_Names.size());
+
+		if (inserted)
+		{
+			VarType type = TypeOf(name);
+
+			m_Names.push_back(name);
+			m_Types.push_back(type);
+			m_Values.push_back(DefaultValue(type));
+		}
+
+		return it->second;
+	}
+
+	const std::string& VarStorage::GetName(int slot) const
+	{
+		return m_Names[slot];
+	}
+
+	void VarStorage::SetDefaultType(char first, char last, VarType type)
+	{
+		for (char c = first; c <= last; c++)
+			m_Defaults[c - 'A'] = type;
+
+		for (size_t slot = 0; slot < m_Names.size(); slot++)
+		{
+			const std::string& name = m_Names[slot];
+
+			if (VarType_FromName(name) == VarType::Any && first <= name[0] && name[0] <= last)
+			{
+				m_Types[slot] = type;
+				m_Values[slot] = DefaultValue(type);
+			}
+		}
+	}
+
+	VarType VarStorage::TypeOf(const std::string& name) const
+	{
+		VarType type = VarType_FromName(name);
+
+		if (type == VarType::Any && 'A' <= name[0] && name[0] <= 'Z')
+			return m_Defaults[name[0] - 'A'];
+
+		return type;
+	}
+
 	void VarStorage::Set(const std::string& name, const Object& value)
 	{
-		m_Values[name] = value;
+		Set(Resolve(name), value);
 	}
 
 	std::optional<std::reference_wrapper<Object>> VarStorage::Get(const std::string& name)
 	{
-		auto it = m_Values.find(name);
-		if (it == m_Values.end())
+		auto it = m_Slots.find(name);
+		if (it == m_Slots.end())
 			return std::nullopt;
-		return it->second;
+		return Get(it->second);
 	}
 
 	void VarStorage::Clear()
 	{
-		m_Values.clear();
+		m_Defaults.fill(VarType::Any);
+
+		for (size_t slot = 0; slot < m_Names.size(); slot++)
+		{
+			m_Types[slot] = VarType_FromName(m_Names[slot]);
+			m_Values[slot] = DefaultValue(m_Types[slot]);
+		}
 	}
 }